@@ -0,0 +1,115 @@
+/*
+ * BVH build, refit and query throughput at 10k, 100k and 1M objects
+ */
+#include <chrono>
+#include <random>
+#include <vector>
+#include <fmt/printf.h>
+
+#include "bvh.h"
+#include "camera.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsed(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void run(size_t objectCount)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 1.0f);
+    std::uniform_real_distribution<float> ndc(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> jitter(-0.05f, 0.05f);
+
+    std::vector<AABB> bounds(objectCount);
+    for(auto& box : bounds) {
+        glm::vec3 c(pos(rng), pos(rng), pos(rng));
+        glm::vec3 e(size(rng));
+        box = AABB{c - e, c + e};
+    }
+
+    Bvh bvh;
+    auto start = Clock::now();
+    bvh.build(bounds);
+    double buildTime = elapsed(start);
+
+    // Move every object a little and refit
+    for(auto& box : bounds) {
+        glm::vec3 d(jitter(rng), jitter(rng), jitter(rng));
+        box.min += d;
+        box.max += d;
+    }
+    start = Clock::now();
+    bvh.refit(bounds);
+    double refitTime = elapsed(start);
+
+    // Frustum culling from a few camera orientations
+    std::vector<uint32_t> result;
+    result.reserve(objectCount);
+    const int frustumQueries = 50;
+    size_t visible = 0;
+    start = Clock::now();
+    for(int i = 0; i < frustumQueries; i++) {
+        Camera camera(glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f), i * 7.2f, 0.0f);
+        result.clear();
+        bvh.cullFrustum(camera.getFrustum(800.0f / 600.0f), result);
+        visible += result.size();
+    }
+    double cullTime = elapsed(start) / frustumQueries;
+
+    // Picking rays
+    Camera camera(glm::vec3(0.0f, 0.0f, 120.0f));
+    const int rayCount = 100000;
+    std::vector<Ray> rays(rayCount);
+    for(auto& ray : rays)
+        ray = camera.getRay(ndc(rng), ndc(rng), 800.0f / 600.0f);
+
+    int hits = 0;
+    start = Clock::now();
+    for(const auto& ray : rays) {
+        BvhHit hit;
+        if(bvh.raycast(ray, 1000.0f, hit))
+            hits++;
+    }
+    double rayTime = elapsed(start);
+
+    // Light-to-cluster assignment: objects act as light volumes, each
+    // cluster of a 16x9x24 grid collects the lights overlapping it
+    const int cx = 16, cy = 9, cz = 24;
+    size_t assignments = 0;
+    start = Clock::now();
+    for(int z = 0; z < cz; z++) {
+        for(int y = 0; y < cy; y++) {
+            for(int x = 0; x < cx; x++) {
+                glm::vec3 cmin(-100.0f + x * 200.0f / cx,
+                               -100.0f + y * 200.0f / cy,
+                               -100.0f + z * 200.0f / cz);
+                glm::vec3 cmax = cmin + glm::vec3(200.0f / cx, 200.0f / cy, 200.0f / cz);
+                result.clear();
+                bvh.queryAabb(AABB{cmin, cmax}, result);
+                assignments += result.size();
+            }
+        }
+    }
+    double clusterTime = elapsed(start);
+
+    fmt::printf("%8zu objects: build %8.2f ms  refit %7.2f ms  nodes %zu\n",
+                objectCount, buildTime * 1000.0, refitTime * 1000.0, bvh.nodes().size());
+    fmt::printf("                  cull %8.3f ms/query (%zu visible)\n",
+                cullTime * 1000.0, visible / frustumQueries);
+    fmt::printf("                  raycast %6.2f Mrays/s (%d hits)\n",
+                rayCount / rayTime / 1e6, hits);
+    fmt::printf("                  clusters %6.2f ms for %d clusters (%zu assignments)\n",
+                clusterTime * 1000.0, cx * cy * cz, assignments);
+}
+
+int main(int argc, char** argv)
+{
+    run(10000);
+    run(100000);
+    run(1000000);
+    return 0;
+}
@@ -0,0 +1,80 @@
+/*
+ * Frustum culling throughput for 1M objects, scalar vs AVX kernels
+ */
+#include <chrono>
+#include <random>
+#include <vector>
+#include <fmt/printf.h>
+
+#include "camera.h"
+#include "culling.h"
+
+static const size_t OBJECT_COUNT = 1000000;
+static const int ITERATIONS = 20;
+
+template<typename Fn>
+static double measure(Fn fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < ITERATIONS; i++)
+        fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count() / ITERATIONS;
+}
+
+int main(int argc, char** argv)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+    SphereBatch spheres;
+    AabbBatch boxes;
+    spheres.reserve(OBJECT_COUNT);
+    boxes.reserve(OBJECT_COUNT);
+    for(size_t i = 0; i < OBJECT_COUNT; i++) {
+        glm::vec3 c(pos(rng), pos(rng), pos(rng));
+        float r = size(rng);
+        spheres.push_back(c, r);
+        boxes.push_back(AABB{c - glm::vec3(r), c + glm::vec3(r)});
+    }
+
+    Camera camera(glm::vec3(0.0f, 0.0f, 0.0f));
+    Frustum frustum = camera.getFrustum(800.0f / 600.0f);
+
+    std::vector<uint32_t> visible;
+    visible.reserve(OBJECT_COUNT);
+
+    fmt::printf("objects: %d, avx: %s\n", (int)OBJECT_COUNT, cullHasAvx() ? "yes" : "no");
+
+    struct {
+        const char* name;
+        bool aabb;
+        CullKernel kernel;
+    } runs[] = {
+        { "spheres/scalar", false, CullKernel::SCALAR },
+        { "spheres/auto",   false, CullKernel::AUTO },
+        { "aabbs/scalar",   true,  CullKernel::SCALAR },
+        { "aabbs/auto",     true,  CullKernel::AUTO },
+    };
+
+    for(const auto& run : runs) {
+        size_t count = 0;
+        double seconds = measure([&]() {
+            visible.clear();
+            if(run.aabb)
+                count = cullAabbs(frustum, boxes, visible, run.kernel);
+            else
+                count = cullSpheres(frustum, spheres, visible, run.kernel);
+        });
+
+        fmt::printf("%-16s %8.3f ms  %8.1f Mobj/s  visible %zu  draw calls saved %zu\n",
+                    run.name,
+                    seconds * 1000.0,
+                    OBJECT_COUNT / seconds / 1e6,
+                    count,
+                    OBJECT_COUNT - count);
+    }
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+/*
+ * Job system: cost of spawning and waiting on empty jobs, and a
+ * parallelFor building 1M model matrices from 1 thread up to one per core
+ * Usage: bench_job_system [max threads]
+ */
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+#include <fmt/printf.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "job_system.h"
+
+static const size_t TRANSFORM_COUNT = 1000000;
+static const int SPAWN_COUNT = 100000;
+static const int ITERATIONS = 10;
+
+struct transform {
+    glm::vec3 position;
+    glm::vec3 axis;
+    float angle;
+    float scale;
+};
+
+template<typename Fn>
+static double measure(Fn fn)
+{
+    fn();
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < ITERATIONS; i++)
+        fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / ITERATIONS;
+}
+
+int main(int argc, char** argv)
+{
+    int maxThreads = argc > 1 ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+    if(maxThreads < 1)
+        maxThreads = 1;
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> unit(0.1f, 1.0f);
+    std::vector<transform> transforms(TRANSFORM_COUNT);
+    for(auto& t : transforms)
+        t = transform{ glm::vec3(pos(rng), pos(rng), pos(rng)),
+                       glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng))),
+                       pos(rng), unit(rng) };
+    std::vector<glm::mat4> models(TRANSFORM_COUNT);
+
+    auto buildModel = [&](size_t i) {
+        const transform& t = transforms[i];
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), t.position);
+        model = glm::rotate(model, glm::radians(t.angle), t.axis);
+        models[i] = glm::scale(model, glm::vec3(t.scale));
+    };
+
+    double serial = measure([&] {
+        for(size_t i = 0; i < TRANSFORM_COUNT; i++)
+            buildModel(i);
+    });
+    fmt::printf("%u transforms, plain loop: %.2f ms\n", (unsigned)TRANSFORM_COUNT, serial);
+
+    for(int threads = 1; threads <= maxThreads; threads++) {
+        JobSystem jobs(threads);
+
+        double spawn = measure([&] {
+            JobCounter counter;
+            for(int i = 0; i < SPAWN_COUNT; i++)
+                jobs.run([] {}, &counter);
+            jobs.wait(counter);
+        });
+
+        double parallel = measure([&] {
+            jobs.parallelFor(0, TRANSFORM_COUNT, buildModel);
+        });
+
+        fmt::printf("%2d threads: spawn+run %.0f ns/job, parallelFor %.2f ms (%.2fx)\n",
+                    threads, spawn * 1e6 / SPAWN_COUNT, parallel, serial / parallel);
+    }
+    return 0;
+}
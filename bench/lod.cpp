@@ -0,0 +1,108 @@
+/*
+ * LOD chain generation and a flythrough reporting the triangles submitted
+ * at each distance, compared to drawing everything at full detail
+ */
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+#include <fmt/printf.h>
+
+#include "camera.h"
+#include "lod.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// UV sphere of radius 1
+static MeshData makeSphere(int rings, int segments)
+{
+    MeshData mesh;
+    for(int r = 0; r <= rings; r++) {
+        float phi = glm::radians(180.0f) * r / rings;
+        for(int s = 0; s < segments; s++) {
+            float theta = glm::radians(360.0f) * s / segments;
+            mesh.positions.push_back(glm::vec3(std::sin(phi) * std::cos(theta),
+                                               std::cos(phi),
+                                               std::sin(phi) * std::sin(theta)));
+        }
+    }
+
+    for(int r = 0; r < rings; r++) {
+        for(int s = 0; s < segments; s++) {
+            uint32_t a = r * segments + s;
+            uint32_t b = r * segments + (s + 1) % segments;
+            uint32_t c = a + segments;
+            uint32_t d = b + segments;
+            if(r != 0) {
+                mesh.indices.push_back(a); mesh.indices.push_back(b); mesh.indices.push_back(c);
+            }
+            if(r != rings - 1) {
+                mesh.indices.push_back(b); mesh.indices.push_back(d); mesh.indices.push_back(c);
+            }
+        }
+    }
+
+    return mesh;
+}
+
+int main(int argc, char** argv)
+{
+    MeshData sphere = makeSphere(128, 256);
+
+    auto start = Clock::now();
+    std::vector<MeshLod> lods = buildLodChain(sphere, 8, 0.5f, 64);
+    double buildTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+    fmt::printf("LOD chain built in %.1f ms\n", buildTime * 1000.0);
+    for(size_t i = 0; i < lods.size(); i++)
+        fmt::printf("  level %zu: %7zu triangles, error %.5f\n",
+                    i, lods[i].mesh.triangleCount(), lods[i].error);
+
+    // 2000 spheres scattered along a 400 units corridor, camera flying
+    // down the corridor at 800x600
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> side(-20.0f, 20.0f);
+    std::uniform_real_distribution<float> along(-400.0f, 0.0f);
+    std::vector<glm::vec3> objects(2000);
+    for(auto& p : objects)
+        p = glm::vec3(side(rng), side(rng), along(rng));
+
+    const int frames = 400;
+    const int windowHeight = 600;
+    const float bandSize = 50.0f;
+    const int bandCount = 9;
+    std::vector<double> submitted(bandCount, 0.0), full(bandCount, 0.0);
+    std::vector<int> current(objects.size(), -1);
+    size_t switches = 0;
+
+    LodSelector selector(1.0f, 0.2f);
+    for(int frame = 0; frame < frames; frame++) {
+        Camera camera(glm::vec3(0.0f, 0.0f, 10.0f - frame * 1.0f));
+        selector.setView(camera, windowHeight);
+
+        for(size_t i = 0; i < objects.size(); i++) {
+            int level = selector.select(objects[i], 1.0f, lods, current[i]);
+            if(current[i] >= 0 && level != current[i])
+                switches++;
+            current[i] = level;
+
+            int band = std::min(bandCount - 1,
+                                (int)(glm::length(objects[i] - camera.position()) / bandSize));
+            submitted[band] += lods[level].mesh.triangleCount();
+            full[band] += lods[0].mesh.triangleCount();
+        }
+    }
+
+    fmt::printf("\ndistance      triangles/frame    full detail   ratio\n");
+    for(int b = 0; b < bandCount; b++) {
+        if(full[b] == 0.0)
+            continue;
+        fmt::printf("%4.0f-%-4.0f %16.0f %14.0f %6.2f%%\n",
+                    b * bandSize, (b + 1) * bandSize,
+                    submitted[b] / frames, full[b] / frames,
+                    100.0 * submitted[b] / full[b]);
+    }
+    fmt::printf("LOD switches: %zu over %d frames\n", switches, frames);
+
+    return 0;
+}
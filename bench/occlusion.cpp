@@ -0,0 +1,88 @@
+/*
+ * Software occlusion culling: occluder rasterization time and the number
+ * of objects hidden behind a wall of containers
+ */
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include <fmt/printf.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "camera.h"
+#include "meshes.h"
+#include "occlusion.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsed(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void run(int threadCount)
+{
+    const int frames = 50;
+    const int objectCount = 100000;
+
+    Camera camera(glm::vec3(0.0f, 0.0f, 5.0f));
+    glm::mat4 viewProjection = camera.getProjectionMatrix(800.0f / 600.0f) * camera.getViewMatrix();
+
+    // Wall of 20x20 containers in front of the camera, with a few gaps
+    std::vector<glm::mat4> occluders;
+    for(int y = -10; y < 10; y++) {
+        for(int x = -10; x < 10; x++) {
+            if((x * 7 + y * 3) % 11 == 0)
+                continue;
+            occluders.push_back(glm::translate(glm::mat4(), glm::vec3(x, y, -5.0f)));
+        }
+    }
+
+    // Small objects scattered behind (and some in front of) the wall
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> xy(-8.0f, 8.0f);
+    std::uniform_real_distribution<float> depth(-60.0f, 2.0f);
+    std::vector<AABB> objects(objectCount);
+    for(auto& box : objects) {
+        glm::vec3 c(xy(rng), xy(rng), depth(rng));
+        box = AABB{c - glm::vec3(0.2f), c + glm::vec3(0.2f)};
+    }
+
+    OcclusionCuller culler(256, 128, threadCount);
+
+    double rasterTime = 0.0, testTime = 0.0;
+    int occluded = 0;
+    for(int frame = 0; frame < frames; frame++) {
+        auto start = Clock::now();
+        culler.beginFrame(viewProjection);
+        for(const auto& model : occluders)
+            culler.addOccluder(cube1, 36, 3, model);
+        culler.rasterize();
+        rasterTime += elapsed(start);
+
+        start = Clock::now();
+        occluded = 0;
+        for(const auto& box : objects) {
+            if(culler.isOccluded(box))
+                occluded++;
+        }
+        testTime += elapsed(start);
+    }
+
+    fmt::printf("threads %2d: raster+hiz %7.3f ms (%u tris, %u binned)  test %7.3f ms  "
+                "occluded %d/%d (draw calls saved)\n",
+                threadCount,
+                rasterTime / frames * 1000.0,
+                culler.stats().triangles,
+                culler.stats().binnedTriangles,
+                testTime / frames * 1000.0,
+                occluded, objectCount);
+}
+
+int main(int argc, char** argv)
+{
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for(int threads = 1; threads <= maxThreads; threads *= 2)
+        run(threads);
+    return 0;
+}
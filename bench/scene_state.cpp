@@ -0,0 +1,51 @@
+/*
+ * Scene state handoff: serializes a resource table and some scene data,
+ * parses it back and adopts every resource, like a reload of a scene
+ * holding that many resources would.
+ * Usage: bench_scene_state [resources]
+ */
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+#include <fmt/printf.h>
+
+#include "scene_state.h"
+
+static const int ITERATIONS = 100;
+
+int main(int argc, char** argv)
+{
+    int resourceCount = argc > 1 ? atoi(argv[1]) : 500;
+
+    std::vector<std::string> names;
+    std::vector<uint64_t> keys;
+    for(int i = 0; i < resourceCount; i++) {
+        names.push_back(fmt::format("resource{}.vao", i));
+        keys.push_back(state_hash(names.back()));
+    }
+    std::vector<float> simulation(4096, 1.0f);
+
+    size_t blobSize = 0, adopted = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int iteration = 0; iteration < ITERATIONS; iteration++) {
+        StateWriter writer;
+        writer.setVersion(1);
+        writer.write(simulation.data(), simulation.size() * sizeof(float));
+        for(int i = 0; i < resourceCount; i++)
+            writer.addResource(names[i], RESOURCE_VERTEX_ARRAY, i + 1, keys[i]);
+        auto blob = writer.finish();
+        blobSize = blob.size();
+
+        StateReader reader(blob);
+        reader.read(simulation.data(), simulation.size() * sizeof(float));
+        for(int i = 0; i < resourceCount; i++)
+            adopted += reader.adopt(names[i], RESOURCE_VERTEX_ARRAY, keys[i]) != 0;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    fmt::printf("%d resources, %u byte blob: %.3f ms per handoff (%u adopted)\n",
+                resourceCount, (unsigned)blobSize, ms / ITERATIONS, (unsigned)(adopted / ITERATIONS));
+    return 0;
+}
@@ -0,0 +1,35 @@
+/*
+ * SDF font generation: builds the distance field atlas with one thread and
+ * with every core, then reloads it from the disk cache.
+ * Usage: bench_sdf_font [font.ttf]
+ */
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fmt/printf.h>
+
+#include "sdf_font.h"
+#include "system.h"
+
+int main(int argc, char** argv)
+{
+    const char* fontFile = argc > 1 ? argv[1] : "res/dos.ttf";
+    std::vector<unsigned char> font = sys::readfile(fontFile);
+    std::string cacheFile = "bench_sdf_font.sdf";
+    remove(cacheFile.c_str());
+
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    SdfFont single(font, "", 32, 95, 1);
+    SdfFont parallel(font, cacheFile, 32, 95, threads);
+    SdfFont cached(font, cacheFile, 32, 95, threads);
+
+    fmt::printf("1 thread:   %8.2f ms\n", single.loadTime() * 1000.0);
+    fmt::printf("%u threads: %8.2f ms\n", threads, parallel.loadTime() * 1000.0);
+    fmt::printf("cache:      %8.2f ms (%s)\n", cached.loadTime() * 1000.0,
+                cached.fromCache() ? "hit" : "miss");
+
+    remove(cacheFile.c_str());
+    return 0;
+}
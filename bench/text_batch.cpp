@@ -0,0 +1,81 @@
+/*
+ * Text batching: 100k glyphs per frame through the glyph atlas, reporting
+ * time per frame and heap allocations once the cache is warm.
+ * Usage: bench_text_batch [font.ttf]
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+#include <fmt/printf.h>
+
+#include "glyph_atlas.h"
+#include "system.h"
+#include "text_batch.h"
+
+static std::atomic<unsigned long> allocations(0);
+
+void* operator new(size_t size)
+{
+    allocations++;
+    void* p = malloc(size ? size : 1);
+    if(!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+static const int GLYPHS_PER_FRAME = 100000;
+static const int FRAMES = 100;
+
+int main(int argc, char** argv)
+{
+    const char* fontFile = argc > 1 ? argv[1] : "res/dos.ttf";
+    GlyphAtlas atlas(sys::readfile(fontFile));
+    TextBatch batch(atlas);
+
+    // Lines of 80 glyphs in a few sizes, like a busy debug overlay
+    static const int sizes[] = { 12, 16, 24 };
+    std::vector<std::string> lines;
+    for(int i = 0; i < 64; i++) {
+        std::string line;
+        for(int c = 0; c < 80; c++)
+            line += (char)(33 + (i * 7 + c * 13) % 94);
+        lines.push_back(line);
+    }
+    int linesPerFrame = GLYPHS_PER_FRAME / 80;
+
+    auto frame = [&]() {
+        atlas.beginFrame();
+        batch.clear();
+        for(int i = 0; i < linesPerFrame; i++) {
+            const std::string& line = lines[i % lines.size()];
+            int size = sizes[i % 3];
+            batch.text(10.0f, 20.0f + (i % 60) * size, line.data(), line.size(), 0xFFFFFFFF, size);
+        }
+    };
+
+    // Warm up: rasterize every glyph and grow the vertex storage
+    frame();
+    fmt::printf("warm up: %u glyphs rasterized, %u evictions\n",
+                atlas.stats().misses, atlas.stats().evictions);
+
+    unsigned long before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < FRAMES; i++)
+        frame();
+    auto end = std::chrono::steady_clock::now();
+    unsigned long allocated = allocations - before;
+
+    double ms = std::chrono::duration<double, std::milli>(end - start).count() / FRAMES;
+    fmt::printf("%d glyphs/frame: %.3f ms/frame (%.1f Mglyphs/s), %d quads\n",
+                GLYPHS_PER_FRAME, ms, GLYPHS_PER_FRAME / ms / 1000.0, (int)batch.quadCount());
+    fmt::printf("allocations over %d frames: %lu\n", FRAMES, allocated);
+    return 0;
+}
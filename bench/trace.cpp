@@ -0,0 +1,48 @@
+/*
+ * Cost of a TRACE_SCOPE, single thread and with all cores tracing
+ */
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <fmt/printf.h>
+
+#include "trace.h"
+
+static const int SCOPES = 10000000;
+
+static double run()
+{
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < SCOPES; i++) {
+        trace::Scope scope("bench");
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / SCOPES;
+}
+
+int main(int argc, char** argv)
+{
+    // Warm up and register the thread buffer
+    run();
+    fmt::printf("1 thread:  %.1f ns/scope\n", run());
+
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<double> results(threadCount);
+    std::vector<std::thread> threads;
+    for(unsigned t = 0; t < threadCount; t++)
+        threads.emplace_back([&results, t]() { results[t] = run(); });
+    for(auto& thread : threads)
+        thread.join();
+
+    double worst = 0.0;
+    for(double r : results)
+        worst = std::max(worst, r);
+    fmt::printf("%u threads: %.1f ns/scope (slowest thread)\n", threadCount, worst);
+
+    if(argc > 1) {
+        trace::flush(argv[1]);
+        fmt::printf("wrote %s\n", argv[1]);
+    }
+    return 0;
+}
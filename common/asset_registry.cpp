@@ -0,0 +1,76 @@
+#include "asset_registry.h"
+#include "trace.h"
+
+#include <algorithm>
+
+AssetRegistry::AssetRegistry():
+    _nextId(1),
+    _reloads(0)
+{
+}
+
+AssetRegistry& AssetRegistry::instance()
+{
+    static AssetRegistry registry;
+    return registry;
+}
+
+unsigned AssetRegistry::watch(const std::string& path, reload_callback reload)
+{
+    unsigned id = _nextId++;
+    _watches.push_back(Watch{ id, path, reload });
+    return id;
+}
+
+void AssetRegistry::unwatch(unsigned id)
+{
+    _watches.erase(std::remove_if(_watches.begin(), _watches.end(),
+                                  [id](const Watch& watch) { return watch.id == id; }),
+                   _watches.end());
+    _tasks.erase(std::remove_if(_tasks.begin(), _tasks.end(),
+                                [id](const Task& task) { return task.id == id; }),
+                 _tasks.end());
+}
+
+void AssetRegistry::defer(unsigned id, pending_task task)
+{
+    _tasks.push_back(Task{ id, task });
+}
+
+bool AssetRegistry::changed(const std::string& path)
+{
+    TRACE_SCOPE("AssetRegistry::changed");
+
+    // Callbacks only defer tasks, the watch list stays put while iterating
+    bool found = false;
+    for(const auto& watch : _watches) {
+        if(watch.path == path) {
+            watch.reload();
+            _reloads++;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void AssetRegistry::update()
+{
+    for(size_t i = 0; i < _tasks.size(); ) {
+        // Finishing swaps in the new object, which counts as a reload too
+        if(_tasks[i].task()) {
+            _tasks.erase(_tasks.begin() + i);
+            _reloads++;
+        } else
+            i++;
+    }
+}
+
+unsigned AssetRegistry::reloads() const
+{
+    return _reloads;
+}
+
+size_t AssetRegistry::pending() const
+{
+    return _tasks.size();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+ * Source files of live assets, for fine-grained hot reload.
+ *
+ * Shaders and textures register the files they were built from. When the
+ * file watcher reports one, changed() runs the reload callbacks of that
+ * file only. Reloads that finish asynchronously (background decoding,
+ * parallel shader compilation) defer a task which update() polls once per
+ * frame until it reports completion.
+ *
+ * Shared by the program and the scene library; GL thread only.
+ */
+class AssetRegistry {
+    public:
+        typedef std::function<void()> reload_callback;
+        typedef std::function<bool()> pending_task;     /* Returns true once done */
+
+    private:
+        struct Watch {
+            unsigned id;
+            std::string path;
+            reload_callback reload;
+        };
+
+        struct Task {
+            unsigned id;
+            pending_task task;
+        };
+
+        std::vector<Watch> _watches;
+        std::vector<Task> _tasks;
+        unsigned _nextId;
+        unsigned _reloads;
+
+        AssetRegistry();
+
+    public:
+        static AssetRegistry& instance();
+
+        unsigned watch(const std::string& path, reload_callback reload);
+        void unwatch(unsigned id);                      /* Drops its pending tasks as well */
+        void defer(unsigned id, pending_task task);
+
+        // False when no asset depends on path
+        bool changed(const std::string& path);
+        void update();
+
+        unsigned reloads() const;                       /* Reload callbacks and deferred tasks run so far */
+        size_t pending() const;
+};
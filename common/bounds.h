@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+/*
+ * Axis aligned bounding box
+ */
+struct AABB {
+    glm::vec3 min;
+    glm::vec3 max;
+
+    glm::vec3 center() const
+    {
+        return (min + max) * 0.5f;
+    }
+
+    glm::vec3 extents() const
+    {
+        return (max - min) * 0.5f;
+    }
+};
+
+/*
+ * Bounding sphere
+ */
+struct Sphere {
+    glm::vec3 center;
+    float radius;
+};
+
+/*
+ * Half line starting at origin
+ */
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
@@ -0,0 +1,452 @@
+#include "bvh.h"
+
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+static const float INF = std::numeric_limits<float>::infinity();
+
+static float surfaceArea(const glm::vec3& min, const glm::vec3& max)
+{
+    glm::vec3 e = max - min;
+    return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+static bool overlaps(const BvhNode& node, const AABB& box)
+{
+    return node.min.x <= box.max.x && node.max.x >= box.min.x &&
+           node.min.y <= box.max.y && node.max.y >= box.min.y &&
+           node.min.z <= box.max.z && node.max.z >= box.min.z;
+}
+
+static bool overlaps(const AABB& a, const AABB& b)
+{
+    return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+           a.min.y <= b.max.y && a.max.y >= b.min.y &&
+           a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+static bool overlaps(const glm::vec3& min, const glm::vec3& max, const Sphere& sphere)
+{
+    glm::vec3 closest = glm::max(min, glm::min(sphere.center, max));
+    glm::vec3 d = closest - sphere.center;
+    return glm::dot(d, d) <= sphere.radius * sphere.radius;
+}
+
+// Slab test, returns the entry distance or INF on miss
+static float intersectRay(const glm::vec3& min, const glm::vec3& max,
+                          const glm::vec3& origin, const glm::vec3& invDir,
+                          float maxDistance)
+{
+    float tx1 = (min.x - origin.x) * invDir.x, tx2 = (max.x - origin.x) * invDir.x;
+    float tmin = std::min(tx1, tx2), tmax = std::max(tx1, tx2);
+    float ty1 = (min.y - origin.y) * invDir.y, ty2 = (max.y - origin.y) * invDir.y;
+    tmin = std::max(tmin, std::min(ty1, ty2)); tmax = std::min(tmax, std::max(ty1, ty2));
+    float tz1 = (min.z - origin.z) * invDir.z, tz2 = (max.z - origin.z) * invDir.z;
+    tmin = std::max(tmin, std::min(tz1, tz2)); tmax = std::min(tmax, std::max(tz1, tz2));
+
+    if(tmax >= tmin && tmax >= 0.0f && tmin < maxDistance)
+        return std::max(tmin, 0.0f);
+    return INF;
+}
+
+/*
+ * Classify a box against the frustum planes still set in mask.
+ * Returns false when outside, otherwise clears the bits of the planes the
+ * box is fully inside of.
+ */
+static bool classify(const Frustum& frustum, const glm::vec3& min, const glm::vec3& max,
+                     unsigned& mask)
+{
+    glm::vec3 c = (min + max) * 0.5f;
+    glm::vec3 e = (max - min) * 0.5f;
+    for(int i = 0; i < Frustum::PLANE_COUNT; i++) {
+        if(!(mask & (1u << i)))
+            continue;
+
+        const glm::vec4& p = frustum.plane(i);
+        float d = p.x * c.x + p.y * c.y + p.z * c.z + p.w;
+        float r = std::fabs(p.x) * e.x + std::fabs(p.y) * e.y + std::fabs(p.z) * e.z;
+        if(d + r < 0.0f)
+            return false;
+        if(d - r >= 0.0f)
+            mask &= ~(1u << i);
+    }
+    return true;
+}
+
+void Bvh::build(const std::vector<AABB>& bounds)
+{
+    const uint32_t count = (uint32_t)bounds.size();
+
+    _bounds = bounds;
+    _indices.resize(count);
+    _centroids.resize(count);
+    for(uint32_t i = 0; i < count; i++) {
+        _indices[i] = i;
+        _centroids[i] = bounds[i].center();
+    }
+
+    _nodes.clear();
+    if(count == 0)
+        return;
+
+    // A binary tree with N leaves has at most 2N-1 nodes, reserving up
+    // front keeps node references valid during the build
+    _nodes.reserve(2 * count - 1);
+
+    BvhNode root = {};
+    root.leftFirst = 0;
+    root.count = count;
+    _nodes.push_back(root);
+    updateNodeBounds(0);
+    subdivide(0);
+}
+
+void Bvh::refit(const std::vector<AABB>& bounds)
+{
+    assert(bounds.size() == _bounds.size());
+    _bounds = bounds;
+
+    // Children are always stored after their parent, so a reverse sweep
+    // visits every node after both of its children
+    for(size_t i = _nodes.size(); i-- > 0;) {
+        BvhNode& node = _nodes[i];
+        if(node.isLeaf()) {
+            updateNodeBounds((uint32_t)i);
+        } else {
+            const BvhNode& left = _nodes[node.leftFirst];
+            const BvhNode& right = _nodes[node.leftFirst + 1];
+            node.min = glm::min(left.min, right.min);
+            node.max = glm::max(left.max, right.max);
+        }
+    }
+}
+
+void Bvh::updateNodeBounds(uint32_t nodeIndex)
+{
+    BvhNode& node = _nodes[nodeIndex];
+    node.min = glm::vec3(INF);
+    node.max = glm::vec3(-INF);
+    for(uint32_t i = 0; i < node.count; i++) {
+        const AABB& box = _bounds[_indices[node.leftFirst + i]];
+        node.min = glm::min(node.min, box.min);
+        node.max = glm::max(node.max, box.max);
+    }
+}
+
+float Bvh::findBestSplit(const BvhNode& node, int& bestAxis, float& bestPos) const
+{
+    struct Bin {
+        glm::vec3 min, max;
+        uint32_t count;
+    };
+
+    // Bin on centroid bounds rather than node bounds
+    glm::vec3 cmin(INF), cmax(-INF);
+    for(uint32_t i = 0; i < node.count; i++) {
+        const glm::vec3& c = _centroids[_indices[node.leftFirst + i]];
+        cmin = glm::min(cmin, c);
+        cmax = glm::max(cmax, c);
+    }
+
+    float bestCost = INF;
+    for(int axis = 0; axis < 3; axis++) {
+        float extent = cmax[axis] - cmin[axis];
+        if(extent <= 0.0f)
+            continue;
+
+        Bin bins[BIN_COUNT];
+        for(int b = 0; b < BIN_COUNT; b++) {
+            bins[b].min = glm::vec3(INF);
+            bins[b].max = glm::vec3(-INF);
+            bins[b].count = 0;
+        }
+
+        float scale = BIN_COUNT / extent;
+        for(uint32_t i = 0; i < node.count; i++) {
+            uint32_t prim = _indices[node.leftFirst + i];
+            int b = std::min(BIN_COUNT - 1, (int)((_centroids[prim][axis] - cmin[axis]) * scale));
+            bins[b].count++;
+            bins[b].min = glm::min(bins[b].min, _bounds[prim].min);
+            bins[b].max = glm::max(bins[b].max, _bounds[prim].max);
+        }
+
+        // Sweep from both sides to get the cost of every plane between bins
+        float leftArea[BIN_COUNT - 1], rightArea[BIN_COUNT - 1];
+        uint32_t leftCount[BIN_COUNT - 1], rightCount[BIN_COUNT - 1];
+        glm::vec3 lmin(INF), lmax(-INF), rmin(INF), rmax(-INF);
+        uint32_t lsum = 0, rsum = 0;
+        for(int i = 0; i < BIN_COUNT - 1; i++) {
+            lsum += bins[i].count;
+            leftCount[i] = lsum;
+            if(bins[i].count) {
+                lmin = glm::min(lmin, bins[i].min);
+                lmax = glm::max(lmax, bins[i].max);
+            }
+            leftArea[i] = lsum ? surfaceArea(lmin, lmax) : 0.0f;
+
+            int j = BIN_COUNT - 1 - i;
+            rsum += bins[j].count;
+            rightCount[j - 1] = rsum;
+            if(bins[j].count) {
+                rmin = glm::min(rmin, bins[j].min);
+                rmax = glm::max(rmax, bins[j].max);
+            }
+            rightArea[j - 1] = rsum ? surfaceArea(rmin, rmax) : 0.0f;
+        }
+
+        for(int i = 0; i < BIN_COUNT - 1; i++) {
+            if(leftCount[i] == 0 || rightCount[i] == 0)
+                continue;
+
+            float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+            if(cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestPos = cmin[axis] + (i + 1) / scale;
+            }
+        }
+    }
+
+    return bestCost;
+}
+
+void Bvh::subdivide(uint32_t rootIndex)
+{
+    struct Task {
+        uint32_t node;
+        int depth;
+    };
+
+    std::vector<Task> tasks;
+    tasks.push_back(Task{rootIndex, 0});
+
+    while(!tasks.empty()) {
+        Task task = tasks.back();
+        tasks.pop_back();
+
+        BvhNode& node = _nodes[task.node];
+        if(node.count <= 1 || task.depth >= MAX_DEPTH)
+            continue;
+
+        int axis = 0;
+        float splitPos = 0.0f;
+        float splitCost = findBestSplit(node, axis, splitPos);
+        if(splitCost == INF)
+            continue;
+
+        // Splitting costs one extra node traversal (taken as the cost of
+        // one primitive test)
+        float area = surfaceArea(node.min, node.max);
+        float leafCost = node.count * area;
+        if(node.count <= MAX_LEAF_SIZE && splitCost + area >= leafCost)
+            continue;
+
+        // Partition primitive indices in place
+        uint32_t i = node.leftFirst;
+        uint32_t j = i + node.count;
+        while(i < j) {
+            if(_centroids[_indices[i]][axis] < splitPos)
+                i++;
+            else
+                std::swap(_indices[i], _indices[--j]);
+        }
+
+        uint32_t leftCount = i - node.leftFirst;
+        if(leftCount == 0 || leftCount == node.count)
+            continue;
+
+        uint32_t leftIndex = (uint32_t)_nodes.size();
+        BvhNode left = {}, right = {};
+        left.leftFirst = node.leftFirst;
+        left.count = leftCount;
+        right.leftFirst = i;
+        right.count = node.count - leftCount;
+        node.leftFirst = leftIndex;
+        node.count = 0;
+
+        _nodes.push_back(left);
+        _nodes.push_back(right);
+        updateNodeBounds(leftIndex);
+        updateNodeBounds(leftIndex + 1);
+
+        tasks.push_back(Task{leftIndex, task.depth + 1});
+        tasks.push_back(Task{leftIndex + 1, task.depth + 1});
+    }
+}
+
+void Bvh::collectSubtree(uint32_t nodeIndex, std::vector<uint32_t>& result) const
+{
+    uint32_t stack[MAX_DEPTH + 2];
+    int sp = 0;
+    stack[sp++] = nodeIndex;
+    while(sp) {
+        const BvhNode& node = _nodes[stack[--sp]];
+        if(node.isLeaf()) {
+            result.insert(result.end(),
+                          _indices.begin() + node.leftFirst,
+                          _indices.begin() + node.leftFirst + node.count);
+        } else {
+            stack[sp++] = node.leftFirst;
+            stack[sp++] = node.leftFirst + 1;
+        }
+    }
+}
+
+void Bvh::cullFrustum(const Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+    if(_nodes.empty())
+        return;
+
+    struct Entry {
+        uint32_t node;
+        unsigned mask;
+    };
+
+    Entry stack[MAX_DEPTH + 2];
+    int sp = 0;
+    stack[sp++] = Entry{0, (1u << Frustum::PLANE_COUNT) - 1};
+
+    while(sp) {
+        Entry entry = stack[--sp];
+        const BvhNode& node = _nodes[entry.node];
+
+        unsigned mask = entry.mask;
+        if(!classify(frustum, node.min, node.max, mask))
+            continue;
+
+        // Fully inside: no need to test anything below
+        if(mask == 0) {
+            collectSubtree(entry.node, visible);
+            continue;
+        }
+
+        if(node.isLeaf()) {
+            for(uint32_t i = 0; i < node.count; i++) {
+                uint32_t prim = _indices[node.leftFirst + i];
+                unsigned primMask = mask;
+                if(classify(frustum, _bounds[prim].min, _bounds[prim].max, primMask))
+                    visible.push_back(prim);
+            }
+        } else {
+            stack[sp++] = Entry{node.leftFirst, mask};
+            stack[sp++] = Entry{node.leftFirst + 1, mask};
+        }
+    }
+}
+
+bool Bvh::raycast(const Ray& ray, float maxDistance, BvhHit& hit) const
+{
+    if(_nodes.empty())
+        return false;
+
+    glm::vec3 invDir(1.0f / ray.direction.x,
+                     1.0f / ray.direction.y,
+                     1.0f / ray.direction.z);
+
+    float nearest = maxDistance;
+    bool found = false;
+
+    uint32_t stack[MAX_DEPTH + 2];
+    int sp = 0;
+    if(intersectRay(_nodes[0].min, _nodes[0].max, ray.origin, invDir, nearest) == INF)
+        return false;
+    stack[sp++] = 0;
+
+    while(sp) {
+        const BvhNode& node = _nodes[stack[--sp]];
+
+        if(node.isLeaf()) {
+            for(uint32_t i = 0; i < node.count; i++) {
+                uint32_t prim = _indices[node.leftFirst + i];
+                float t = intersectRay(_bounds[prim].min, _bounds[prim].max,
+                                       ray.origin, invDir, nearest);
+                if(t < nearest) {
+                    nearest = t;
+                    hit.primitive = prim;
+                    hit.distance = t;
+                    found = true;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearest child first so that farther ones get pruned
+        uint32_t a = node.leftFirst, b = node.leftFirst + 1;
+        float ta = intersectRay(_nodes[a].min, _nodes[a].max, ray.origin, invDir, nearest);
+        float tb = intersectRay(_nodes[b].min, _nodes[b].max, ray.origin, invDir, nearest);
+        if(ta > tb) {
+            std::swap(a, b);
+            std::swap(ta, tb);
+        }
+        if(tb != INF)
+            stack[sp++] = b;
+        if(ta != INF)
+            stack[sp++] = a;
+    }
+
+    return found;
+}
+
+void Bvh::queryAabb(const AABB& box, std::vector<uint32_t>& result) const
+{
+    if(_nodes.empty())
+        return;
+
+    uint32_t stack[MAX_DEPTH + 2];
+    int sp = 0;
+    stack[sp++] = 0;
+    while(sp) {
+        const BvhNode& node = _nodes[stack[--sp]];
+        if(!overlaps(node, box))
+            continue;
+
+        if(node.isLeaf()) {
+            for(uint32_t i = 0; i < node.count; i++) {
+                uint32_t prim = _indices[node.leftFirst + i];
+                if(overlaps(_bounds[prim], box))
+                    result.push_back(prim);
+            }
+        } else {
+            stack[sp++] = node.leftFirst;
+            stack[sp++] = node.leftFirst + 1;
+        }
+    }
+}
+
+void Bvh::querySphere(const Sphere& sphere, std::vector<uint32_t>& result) const
+{
+    if(_nodes.empty())
+        return;
+
+    uint32_t stack[MAX_DEPTH + 2];
+    int sp = 0;
+    stack[sp++] = 0;
+    while(sp) {
+        const BvhNode& node = _nodes[stack[--sp]];
+        if(!overlaps(node.min, node.max, sphere))
+            continue;
+
+        if(node.isLeaf()) {
+            for(uint32_t i = 0; i < node.count; i++) {
+                uint32_t prim = _indices[node.leftFirst + i];
+                if(overlaps(_bounds[prim].min, _bounds[prim].max, sphere))
+                    result.push_back(prim);
+            }
+        } else {
+            stack[sp++] = node.leftFirst;
+            stack[sp++] = node.leftFirst + 1;
+        }
+    }
+}
+
+const std::vector<BvhNode>& Bvh::nodes() const
+{
+    return _nodes;
+}
+
+size_t Bvh::primitiveCount() const
+{
+    return _bounds.size();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "frustum.h"
+
+/*
+ * Flattened BVH node, 32 bytes so two siblings share a cache line.
+ * Inner nodes: leftFirst is the index of the left child, the right child
+ * is stored right after it, count is 0.
+ * Leaves: leftFirst is the first entry in the primitive index list.
+ */
+struct BvhNode {
+    glm::vec3 min;
+    uint32_t leftFirst;
+    glm::vec3 max;
+    uint32_t count;
+
+    bool isLeaf() const
+    {
+        return count != 0;
+    }
+};
+
+struct BvhHit {
+    uint32_t primitive;
+    float distance;
+};
+
+/*
+ * Bounding volume hierarchy over primitive bounding boxes, built with
+ * binned SAH. Primitive ids are the indices in the bounds array given to
+ * build().
+ */
+class Bvh {
+    public:
+        static const int BIN_COUNT = 16;
+        static const int MAX_LEAF_SIZE = 4;
+        // Bounded so that queries can use a fixed traversal stack
+        static const int MAX_DEPTH = 60;
+
+    private:
+        std::vector<BvhNode> _nodes;
+        std::vector<uint32_t> _indices;
+        std::vector<AABB> _bounds;
+        std::vector<glm::vec3> _centroids;
+
+    public:
+        void build(const std::vector<AABB>& bounds);
+
+        // Update bounds of moving primitives without changing the topology.
+        // Cheap but the tree quality degrades if objects move a lot.
+        void refit(const std::vector<AABB>& bounds);
+
+        void cullFrustum(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+        bool raycast(const Ray& ray, float maxDistance, BvhHit& hit) const;
+        void queryAabb(const AABB& box, std::vector<uint32_t>& result) const;
+        void querySphere(const Sphere& sphere, std::vector<uint32_t>& result) const;
+
+        const std::vector<BvhNode>& nodes() const;
+        size_t primitiveCount() const;
+
+    private:
+        void updateNodeBounds(uint32_t nodeIndex);
+        void subdivide(uint32_t rootIndex);
+        float findBestSplit(const BvhNode& node, int& axis, float& splitPos) const;
+        void collectSubtree(uint32_t nodeIndex, std::vector<uint32_t>& result) const;
+};
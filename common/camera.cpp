@@ -1,5 +1,14 @@
 #include "camera.h"
 
+constexpr const float Camera::DEFAULT_YAW;
+constexpr const float Camera::DEFAULT_PITCH;
+constexpr const float Camera::DEFAULT_ROLL;
+constexpr const float Camera::DEFAULT_SPEED;
+constexpr const float Camera::DEFAULT_SENSIVITY;
+constexpr const float Camera::DEFAULT_ZOOM;
+constexpr const float Camera::DEFAULT_NEAR;
+constexpr const float Camera::DEFAULT_FAR;
+
 Camera::Camera(glm::vec3 position, glm::vec3 up, float yaw, float pitch):
     _front(glm::vec3(0.0f, 0.0f, -1.0f)), _movementSpeed(DEFAULT_SPEED),
     _mouseSensitivity(DEFAULT_SENSIVITY), _zoom(DEFAULT_ZOOM),
@@ -20,11 +29,32 @@ Camera::Camera(float posX, float posY, float posZ,
     updateCameraVectors();
 }
 
-glm::mat4 Camera::getViewMatrix()
+glm::mat4 Camera::getViewMatrix() const
 {
     return glm::lookAt(_position, _position + _front, _up);
 }
 
+glm::mat4 Camera::getProjectionMatrix(float aspect, float zNear, float zFar) const
+{
+    return glm::perspective(glm::radians(_zoom), aspect, zNear, zFar);
+}
+
+Frustum Camera::getFrustum(float aspect, float zNear, float zFar) const
+{
+    return Frustum(getProjectionMatrix(aspect, zNear, zFar) * getViewMatrix());
+}
+
+Ray Camera::getRay(float ndcX, float ndcY, float aspect) const
+{
+    glm::mat4 inv = glm::inverse(getProjectionMatrix(aspect) * getViewMatrix());
+    glm::vec4 nearPoint = inv * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 farPoint = inv * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 target = glm::vec3(farPoint) / farPoint.w;
+    return Ray{origin, glm::normalize(target - origin)};
+}
+
 void Camera::processKeyboard(CameraMovement direction, float deltaTime)
 {
     float velocity = _movementSpeed * deltaTime;
@@ -87,6 +117,11 @@ void Camera::updateCameraVectors()
 }
 
 
+void Camera::setPosition(const glm::vec3& position)
+{
+    _position = position;
+}
+
 const glm::vec3& Camera::position() const
 {
     return _position;
@@ -6,6 +6,8 @@
 
 #include <vector>
 
+#include "frustum.h"
+
 enum class CameraMovement {
     FORWARD, BACKWARD, LEFT, RIGHT,
     UP, DOWN
@@ -19,6 +21,8 @@ class Camera {
         constexpr static const float DEFAULT_SPEED = 2.5f;
         constexpr static const float DEFAULT_SENSIVITY = 0.1f;
         constexpr static const float DEFAULT_ZOOM = 45.0f;
+        constexpr static const float DEFAULT_NEAR = 0.1f;
+        constexpr static const float DEFAULT_FAR = 100.0f;
 
     private:
         glm::vec3 _position, _front, _up, _right, _worldUp;
@@ -35,11 +39,21 @@ class Camera {
                float upX, float upY, float upZ, 
                float yaw, float pitch);
 
-        glm::mat4 getViewMatrix();
+        glm::mat4 getViewMatrix() const;
+        glm::mat4 getProjectionMatrix(float aspect,
+                                      float zNear = DEFAULT_NEAR,
+                                      float zFar = DEFAULT_FAR) const;
+        Frustum getFrustum(float aspect,
+                           float zNear = DEFAULT_NEAR,
+                           float zFar = DEFAULT_FAR) const;
+        // Picking ray through a point in normalized device coordinates
+        Ray getRay(float ndcX, float ndcY, float aspect) const;
         void processKeyboard(CameraMovement direction, float deltaTime);
         void processMouseMovement(float xoffset, float yoffset, bool constrainPitch = true);
         void processMouseScroll(float xoffset, float yoffset);
 
+        void setPosition(const glm::vec3& position);
+
         const glm::vec3& position() const;
         const glm::vec3& front() const;
         const glm::vec3& up() const;
@@ -6,11 +6,36 @@
 
 #define BUFFER_OBJECT(i) ((void*)(i))
 
+// Counters reset by the main loop at the start of every frame
+struct frame_stats {
+    unsigned drawCalls;
+    unsigned culledObjects;     /* Objects skipped by culling (draw calls saved) */
+    unsigned programBinds, programBindsAvoided;
+    unsigned vaoBinds, vaoBindsAvoided;
+    unsigned textureBinds, textureBindsAvoided;
+    unsigned bufferStalls;      /* CPU waits on the GPU in stream buffers */
+    unsigned uniformUpdates;
+    unsigned picked;            /* 1 + index of the object under the crosshair, 0 for none */
+};
+
+// What a frame gets built from, copied so building can run on another thread
+struct frame_input {
+    float ticks;
+    float alpha;                /* See context::alpha */
+    int windowWidth;
+    int windowHeight;
+    Camera camera;
+};
+
 struct context {
     int windowWidth;
     int windowHeight;
     std::string resDir;
+    std::string cacheDir;       /* Writable, for generated data; empty to not cache it */
     Camera camera;
+    frame_stats stats;
+    size_t textureMemory;       /* Bytes, kept up to date by whoever creates textures */
+    float alpha;                /* Between the last two simulation steps, see scene::update */
 };
 
 
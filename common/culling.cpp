@@ -0,0 +1,260 @@
+#include "culling.h"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CULL_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+ * SphereBatch
+ */
+void SphereBatch::clear()
+{
+    x.clear(); y.clear(); z.clear(); radius.clear();
+}
+
+void SphereBatch::reserve(size_t count)
+{
+    x.reserve(count); y.reserve(count); z.reserve(count); radius.reserve(count);
+}
+
+void SphereBatch::push_back(const glm::vec3& center, float r)
+{
+    x.push_back(center.x);
+    y.push_back(center.y);
+    z.push_back(center.z);
+    radius.push_back(r);
+}
+
+void SphereBatch::set(size_t index, const glm::vec3& center, float r)
+{
+    x[index] = center.x;
+    y[index] = center.y;
+    z[index] = center.z;
+    radius[index] = r;
+}
+
+size_t SphereBatch::size() const
+{
+    return x.size();
+}
+
+/*
+ * AabbBatch
+ */
+void AabbBatch::clear()
+{
+    cx.clear(); cy.clear(); cz.clear();
+    ex.clear(); ey.clear(); ez.clear();
+}
+
+void AabbBatch::reserve(size_t count)
+{
+    cx.reserve(count); cy.reserve(count); cz.reserve(count);
+    ex.reserve(count); ey.reserve(count); ez.reserve(count);
+}
+
+void AabbBatch::push_back(const AABB& box)
+{
+    glm::vec3 c = box.center();
+    glm::vec3 e = box.extents();
+    cx.push_back(c.x); cy.push_back(c.y); cz.push_back(c.z);
+    ex.push_back(e.x); ey.push_back(e.y); ez.push_back(e.z);
+}
+
+void AabbBatch::set(size_t index, const AABB& box)
+{
+    glm::vec3 c = box.center();
+    glm::vec3 e = box.extents();
+    cx[index] = c.x; cy[index] = c.y; cz[index] = c.z;
+    ex[index] = e.x; ey[index] = e.y; ez[index] = e.z;
+}
+
+size_t AabbBatch::size() const
+{
+    return cx.size();
+}
+
+/*
+ * Scalar kernels, also used for the tail of the AVX loops
+ */
+static size_t cullSpheresScalar(const Frustum& frustum, const SphereBatch& batch,
+                                size_t begin, std::vector<uint32_t>& visible)
+{
+    size_t count = 0;
+    for(size_t i = begin; i < batch.size(); i++) {
+        glm::vec3 c(batch.x[i], batch.y[i], batch.z[i]);
+        if(frustum.intersectsSphere(c, batch.radius[i])) {
+            visible.push_back((uint32_t)i);
+            count++;
+        }
+    }
+    return count;
+}
+
+static size_t cullAabbsScalar(const Frustum& frustum, const AabbBatch& batch,
+                              size_t begin, std::vector<uint32_t>& visible)
+{
+    size_t count = 0;
+    for(size_t i = begin; i < batch.size(); i++) {
+        bool inside = true;
+        for(int p = 0; p < Frustum::PLANE_COUNT && inside; p++) {
+            const glm::vec4& pl = frustum.plane(p);
+            float d = pl.x * batch.cx[i] + pl.y * batch.cy[i] + pl.z * batch.cz[i] + pl.w;
+            float r = std::fabs(pl.x) * batch.ex[i] +
+                      std::fabs(pl.y) * batch.ey[i] +
+                      std::fabs(pl.z) * batch.ez[i];
+            inside = d + r >= 0.0f;
+        }
+        if(inside) {
+            visible.push_back((uint32_t)i);
+            count++;
+        }
+    }
+    return count;
+}
+
+#ifdef CULL_X86
+
+// Append the indices of the set bits of an 8-lane mask
+static inline size_t emitMask(int mask, size_t base, std::vector<uint32_t>& visible)
+{
+    size_t count = 0;
+    while(mask) {
+        int bit = __builtin_ctz(mask);
+        visible.push_back((uint32_t)(base + bit));
+        mask &= mask - 1;
+        count++;
+    }
+    return count;
+}
+
+__attribute__((target("avx")))
+static size_t cullSpheresAvx(const Frustum& frustum, const SphereBatch& batch,
+                             std::vector<uint32_t>& visible)
+{
+    __m256 px[Frustum::PLANE_COUNT], py[Frustum::PLANE_COUNT];
+    __m256 pz[Frustum::PLANE_COUNT], pw[Frustum::PLANE_COUNT];
+    for(int p = 0; p < Frustum::PLANE_COUNT; p++) {
+        const glm::vec4& pl = frustum.plane(p);
+        px[p] = _mm256_set1_ps(pl.x);
+        py[p] = _mm256_set1_ps(pl.y);
+        pz[p] = _mm256_set1_ps(pl.z);
+        pw[p] = _mm256_set1_ps(pl.w);
+    }
+
+    size_t count = 0;
+    size_t n = batch.size() & ~size_t(7);
+    const float* xs = batch.x.data();
+    const float* ys = batch.y.data();
+    const float* zs = batch.z.data();
+    const float* rs = batch.radius.data();
+
+    for(size_t i = 0; i < n; i += 8) {
+        __m256 x = _mm256_loadu_ps(xs + i);
+        __m256 y = _mm256_loadu_ps(ys + i);
+        __m256 z = _mm256_loadu_ps(zs + i);
+        __m256 negR = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(rs + i));
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for(int p = 0; p < Frustum::PLANE_COUNT; p++) {
+            __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px[p], x),
+                                                   _mm256_mul_ps(py[p], y)),
+                                     _mm256_add_ps(_mm256_mul_ps(pz[p], z), pw[p]));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, negR, _CMP_GE_OQ));
+        }
+
+        count += emitMask(_mm256_movemask_ps(inside), i, visible);
+    }
+
+    return count + cullSpheresScalar(frustum, batch, n, visible);
+}
+
+__attribute__((target("avx")))
+static size_t cullAabbsAvx(const Frustum& frustum, const AabbBatch& batch,
+                           std::vector<uint32_t>& visible)
+{
+    const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 px[Frustum::PLANE_COUNT], py[Frustum::PLANE_COUNT];
+    __m256 pz[Frustum::PLANE_COUNT], pw[Frustum::PLANE_COUNT];
+    __m256 ax[Frustum::PLANE_COUNT], ay[Frustum::PLANE_COUNT], az[Frustum::PLANE_COUNT];
+    for(int p = 0; p < Frustum::PLANE_COUNT; p++) {
+        const glm::vec4& pl = frustum.plane(p);
+        px[p] = _mm256_set1_ps(pl.x);
+        py[p] = _mm256_set1_ps(pl.y);
+        pz[p] = _mm256_set1_ps(pl.z);
+        pw[p] = _mm256_set1_ps(pl.w);
+        ax[p] = _mm256_and_ps(px[p], signMask);
+        ay[p] = _mm256_and_ps(py[p], signMask);
+        az[p] = _mm256_and_ps(pz[p], signMask);
+    }
+
+    size_t count = 0;
+    size_t n = batch.size() & ~size_t(7);
+    const __m256 zero = _mm256_setzero_ps();
+
+    for(size_t i = 0; i < n; i += 8) {
+        __m256 cx = _mm256_loadu_ps(batch.cx.data() + i);
+        __m256 cy = _mm256_loadu_ps(batch.cy.data() + i);
+        __m256 cz = _mm256_loadu_ps(batch.cz.data() + i);
+        __m256 ex = _mm256_loadu_ps(batch.ex.data() + i);
+        __m256 ey = _mm256_loadu_ps(batch.ey.data() + i);
+        __m256 ez = _mm256_loadu_ps(batch.ez.data() + i);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for(int p = 0; p < Frustum::PLANE_COUNT; p++) {
+            __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px[p], cx),
+                                                   _mm256_mul_ps(py[p], cy)),
+                                     _mm256_add_ps(_mm256_mul_ps(pz[p], cz), pw[p]));
+            __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax[p], ex),
+                                                   _mm256_mul_ps(ay[p], ey)),
+                                     _mm256_mul_ps(az[p], ez));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(d, r), zero, _CMP_GE_OQ));
+        }
+
+        count += emitMask(_mm256_movemask_ps(inside), i, visible);
+    }
+
+    return count + cullAabbsScalar(frustum, batch, n, visible);
+}
+
+bool cullHasAvx()
+{
+    static const bool hasAvx = __builtin_cpu_supports("avx");
+    return hasAvx;
+}
+
+#else
+
+bool cullHasAvx()
+{
+    return false;
+}
+
+#endif
+
+size_t cullSpheres(const Frustum& frustum,
+                   const SphereBatch& batch,
+                   std::vector<uint32_t>& visible,
+                   CullKernel kernel)
+{
+#ifdef CULL_X86
+    if(kernel == CullKernel::AUTO && cullHasAvx())
+        return cullSpheresAvx(frustum, batch, visible);
+#endif
+    return cullSpheresScalar(frustum, batch, 0, visible);
+}
+
+size_t cullAabbs(const Frustum& frustum,
+                 const AabbBatch& batch,
+                 std::vector<uint32_t>& visible,
+                 CullKernel kernel)
+{
+#ifdef CULL_X86
+    if(kernel == CullKernel::AUTO && cullHasAvx())
+        return cullAabbsAvx(frustum, batch, visible);
+#endif
+    return cullAabbsScalar(frustum, batch, 0, visible);
+}
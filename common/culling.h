@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "frustum.h"
+
+/*
+ * Structure-of-arrays batches of bounding volumes, so the culling kernels
+ * can test 8 objects per iteration with AVX.
+ */
+struct SphereBatch {
+    std::vector<float> x, y, z, radius;
+
+    void clear();
+    void reserve(size_t count);
+    void push_back(const glm::vec3& center, float r);
+    void set(size_t index, const glm::vec3& center, float r);
+    size_t size() const;
+};
+
+struct AabbBatch {
+    // Center and half extents
+    std::vector<float> cx, cy, cz, ex, ey, ez;
+
+    void clear();
+    void reserve(size_t count);
+    void push_back(const AABB& box);
+    void set(size_t index, const AABB& box);
+    size_t size() const;
+};
+
+enum class CullKernel {
+    AUTO,       /* AVX when the CPU supports it, scalar otherwise */
+    SCALAR
+};
+
+/*
+ * Test every object of the batch against the frustum and append the
+ * indices of the visible ones to `visible`. Returns the number of visible
+ * objects.
+ */
+size_t cullSpheres(const Frustum& frustum,
+                   const SphereBatch& batch,
+                   std::vector<uint32_t>& visible,
+                   CullKernel kernel = CullKernel::AUTO);
+size_t cullAabbs(const Frustum& frustum,
+                 const AabbBatch& batch,
+                 std::vector<uint32_t>& visible,
+                 CullKernel kernel = CullKernel::AUTO);
+
+bool cullHasAvx();
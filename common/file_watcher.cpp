@@ -0,0 +1,214 @@
+#include "file_watcher.h"
+#include "exception.h"
+#include "system.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fmt/format.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+const size_t FileWatcher::QUEUE_SIZE;
+const int FileWatcher::SETTLE_TIME;
+const int FileWatcher::POLL_INTERVAL;
+
+bool file_mtime(const std::string& path, timespec& mtime)
+{
+    struct stat st;
+    if(stat(path.c_str(), &st) == -1)
+        return false;
+#ifdef __APPLE__
+    mtime = st.st_mtimespec;
+#else
+    mtime = st.st_mtim;
+#endif
+    return true;
+}
+
+static bool isDirectory(const std::string& path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+FileWatcher::FileWatcher():
+    _events(QUEUE_SIZE),
+    _inotify(-1),
+    _dropped(0)
+{
+    if(pipe(_wakeup) == -1)
+        throw sys::errno_exception();
+#ifdef __linux__
+    _inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    _thread = std::thread(&FileWatcher::run, this);
+}
+
+FileWatcher::~FileWatcher()
+{
+    char c = 0;
+    if(write(_wakeup[1], &c, 1) == 1)
+        _thread.join();
+    else
+        _thread.detach();
+    close(_wakeup[0]);
+    close(_wakeup[1]);
+    if(_inotify != -1)
+        close(_inotify);
+}
+
+void FileWatcher::watch(const std::string& path)
+{
+    bool directory = isDirectory(path);
+    std::lock_guard<std::mutex> lock(_mutex);
+    _watches[path] = directory;
+
+#ifdef __linux__
+    if(_inotify != -1) {
+        std::string dir = directory ? path : sys::dirname(path);
+        int wd = inotify_add_watch(_inotify, dir.c_str(),
+                                   IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ATTRIB);
+        if(wd == -1)
+            throw Exception(fmt::format("Cannot watch \"{}\"", path));
+        _directories[wd] = dir;
+        return;
+    }
+#endif
+    snapshot(path, directory, false);
+}
+
+bool FileWatcher::poll(file_event& event)
+{
+    return _events.pop(event);
+}
+
+bool FileWatcher::native() const
+{
+    return _inotify != -1;
+}
+
+unsigned FileWatcher::dropped() const
+{
+    return _dropped;
+}
+
+void FileWatcher::run()
+{
+    TRACE_THREAD_NAME("file watcher");
+    while(true) {
+        int timeout = flush();
+        if(_inotify == -1)
+            timeout = timeout < 0 ? POLL_INTERVAL : std::min(timeout, POLL_INTERVAL);
+
+        pollfd fds[2] = {
+            { _wakeup[0], POLLIN, 0 },
+            { _inotify, POLLIN, 0 }
+        };
+        int ret = ::poll(fds, _inotify != -1 ? 2 : 1, timeout);
+        if(ret > 0 && fds[0].revents)
+            break;
+
+        if(_inotify != -1) {
+            if(ret > 0 && (fds[1].revents & POLLIN))
+                readNotifications();
+        } else {
+            scan();
+        }
+    }
+}
+
+void FileWatcher::readNotifications()
+{
+#ifdef __linux__
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    while((length = read(_inotify, buffer, sizeof(buffer))) > 0) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for(char* p = buffer; p < buffer + length; ) {
+            const inotify_event* e = (const inotify_event*)p;
+            p += sizeof(inotify_event) + e->len;
+            if(!e->len || (e->mask & IN_ISDIR))
+                continue;
+
+            auto dir = _directories.find(e->wd);
+            if(dir == _directories.end())
+                continue;
+
+            std::string path = fmt::format("{}/{}", dir->second, e->name);
+            auto file = _watches.find(path);
+            auto parent = _watches.find(dir->second);
+            if(file != _watches.end() || (parent != _watches.end() && parent->second))
+                changed(path);
+        }
+    }
+#endif
+}
+
+// Polling fallback: compare modification times with the last scan
+void FileWatcher::scan()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for(const auto& watch : _watches)
+        snapshot(watch.first, watch.second, true);
+}
+
+void FileWatcher::snapshot(const std::string& path, bool directory, bool report)
+{
+    if(directory) {
+        DIR* dir = opendir(path.c_str());
+        if(!dir)
+            return;
+        while(dirent* entry = readdir(dir)) {
+            std::string file = fmt::format("{}/{}", path, entry->d_name);
+            if(entry->d_name[0] != '.' && !isDirectory(file))
+                snapshot(file, false, report);
+        }
+        closedir(dir);
+        return;
+    }
+
+    timespec mtime;
+    if(!file_mtime(path, mtime))
+        return;
+    auto it = _mtimes.find(path);
+    if(it == _mtimes.end()) {
+        _mtimes[path] = mtime;
+        if(report)
+            changed(path);
+    } else if(it->second.tv_sec != mtime.tv_sec || it->second.tv_nsec != mtime.tv_nsec) {
+        it->second = mtime;
+        if(report)
+            changed(path);
+    }
+}
+
+void FileWatcher::changed(const std::string& path)
+{
+    _pending[path] = clock::now() + std::chrono::milliseconds(SETTLE_TIME);
+}
+
+// Post the paths quiet for long enough, returns milliseconds to the next deadline or -1
+int FileWatcher::flush()
+{
+    auto now = clock::now();
+    int timeout = -1;
+    for(auto it = _pending.begin(); it != _pending.end(); ) {
+        if(it->second <= now) {
+            if(!_events.push(file_event{ it->first }))
+                _dropped++;
+            it = _pending.erase(it);
+        } else {
+            int ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(it->second - now).count() + 1;
+            timeout = timeout < 0 ? ms : std::min(timeout, ms);
+            ++it;
+        }
+    }
+    return timeout;
+}
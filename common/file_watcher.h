@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <time.h>
+
+#include "spsc_queue.h"
+
+struct file_event {
+    std::string path;           /* As given to watch(), plus the file name for directories */
+};
+
+/*
+ * Watches files and directories from a background thread.
+ *
+ * On Linux changes come from inotify on the parent directories, so files
+ * replaced by a rename (editors, linkers) are still seen. Elsewhere the
+ * thread falls back to polling modification times. A path is reported
+ * once it has been quiet for SETTLE_TIME, which folds the bursts of
+ * writes a build produces into one event.
+ *
+ * Events go through a lock-free queue: poll() never makes a system call
+ * and is meant to be drained once per frame, from a single thread.
+ */
+class FileWatcher {
+    public:
+        static const size_t QUEUE_SIZE = 256;
+        static const int SETTLE_TIME = 50;          /* Milliseconds */
+        static const int POLL_INTERVAL = 250;       /* Milliseconds, polling fallback */
+
+    private:
+        typedef std::chrono::steady_clock clock;
+
+        SpscQueue<file_event> _events;
+        std::mutex _mutex;              /* Guards the maps shared with watch() */
+        std::map<std::string, bool> _watches;       /* Path to whether it is a directory */
+        std::map<int, std::string> _directories;    /* inotify descriptor to directory */
+        std::map<std::string, timespec> _mtimes;    /* Polling fallback */
+        std::map<std::string, clock::time_point> _pending;
+        int _inotify;
+        int _wakeup[2];
+        std::thread _thread;
+        std::atomic<unsigned> _dropped;
+
+    public:
+        FileWatcher();
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        // Changes to a directory report the files inside, not recursively
+        void watch(const std::string& path);
+
+        bool poll(file_event& event);
+
+        bool native() const;            /* False when polling */
+        unsigned dropped() const;       /* Events lost to a full queue */
+
+    private:
+        void run();
+        void readNotifications();
+        void scan();
+        void snapshot(const std::string& path, bool directory, bool report);
+        void changed(const std::string& path);
+        int flush();
+};
+
+// Modification time of a file, false if it can't be stat'ed
+bool file_mtime(const std::string& path, timespec& mtime);
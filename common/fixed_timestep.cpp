@@ -0,0 +1,53 @@
+#include "fixed_timestep.h"
+
+#include <algorithm>
+
+const int FixedTimestep::MAX_STEPS;
+
+FixedTimestep::FixedTimestep(double dt):
+    _dt(dt),
+    _accumulator(0.0),
+    _time(0.0),
+    _steps(0)
+{
+}
+
+void FixedTimestep::advance(double elapsed)
+{
+    _accumulator += std::max(elapsed, 0.0);
+    _steps = (int)(_accumulator / _dt);
+    if(_steps > MAX_STEPS) {
+        _steps = MAX_STEPS;
+        _accumulator = MAX_STEPS * _dt;
+    }
+}
+
+bool FixedTimestep::step()
+{
+    if(_steps <= 0)
+        return false;
+    _steps--;
+    _accumulator -= _dt;
+    _time += _dt;
+    return true;
+}
+
+double FixedTimestep::dt() const
+{
+    return _dt;
+}
+
+double FixedTimestep::time() const
+{
+    return _time;
+}
+
+double FixedTimestep::lag() const
+{
+    return _accumulator;
+}
+
+float FixedTimestep::alpha() const
+{
+    return (float)std::min(std::max(_accumulator / _dt, 0.0), 1.0);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+/*
+ * Fixed-rate simulation clock.
+ *
+ * Frame times go into an accumulator which step() then drains one fixed
+ * step at a time, so the simulation advances by the same dt whatever the
+ * frame rate. What is left over, as a fraction of a step, is the alpha to
+ * interpolate between the last two simulated states with when drawing.
+ *
+ * A frame longer than MAX_STEPS steps is truncated rather than caught up
+ * with, otherwise a slow frame makes the next one even slower.
+ */
+class FixedTimestep {
+    public:
+        static const int MAX_STEPS = 8;
+
+    private:
+        double _dt;
+        double _accumulator;
+        double _time;           /* Simulated so far */
+        int _steps;             /* Left to run this frame */
+
+    public:
+        FixedTimestep(double dt = 1.0 / 60.0);
+
+        // Once per frame, with the real time elapsed since the last one
+        void advance(double elapsed);
+
+        // Run the simulation as long as this returns true
+        bool step();
+
+        double dt() const;
+        double time() const;
+        double lag() const;     /* Real time not simulated yet, in seconds */
+        float alpha() const;
+};
@@ -0,0 +1,71 @@
+#include "frustum.h"
+
+#include <cmath>
+
+Frustum::Frustum()
+{
+    for(int i = 0; i < PLANE_COUNT; i++)
+        _planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Frustum::Frustum(const glm::mat4& m)
+{
+    // Gribb-Hartmann: planes are sums/differences of the rows of the
+    // view-projection matrix. glm is column major, so row i is m[*][i].
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    _planes[LEFT]       = row3 + row0;
+    _planes[RIGHT]      = row3 - row0;
+    _planes[BOTTOM]     = row3 + row1;
+    _planes[TOP]        = row3 - row1;
+    _planes[NEAR_PLANE] = row3 + row2;
+    _planes[FAR_PLANE]  = row3 - row2;
+
+    // Normalize so that plane distances are in world units (needed for spheres)
+    for(int i = 0; i < PLANE_COUNT; i++) {
+        float len = glm::length(glm::vec3(_planes[i]));
+        if(len > 0.0f)
+            _planes[i] = _planes[i] / len;
+    }
+}
+
+const glm::vec4& Frustum::plane(int side) const
+{
+    return _planes[side];
+}
+
+bool Frustum::containsPoint(const glm::vec3& p) const
+{
+    return intersectsSphere(p, 0.0f);
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const
+{
+    for(int i = 0; i < PLANE_COUNT; i++) {
+        if(glm::dot(glm::vec3(_planes[i]), center) + _planes[i].w < -radius)
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::intersectsSphere(const Sphere& sphere) const
+{
+    return intersectsSphere(sphere.center, sphere.radius);
+}
+
+bool Frustum::intersectsAabb(const AABB& box) const
+{
+    glm::vec3 c = box.center();
+    glm::vec3 e = box.extents();
+    for(int i = 0; i < PLANE_COUNT; i++) {
+        glm::vec3 n(_planes[i]);
+        float d = glm::dot(n, c) + _planes[i].w;
+        float r = std::fabs(n.x) * e.x + std::fabs(n.y) * e.y + std::fabs(n.z) * e.z;
+        if(d + r < 0.0f)
+            return false;
+    }
+    return true;
+}
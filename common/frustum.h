@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+/*
+ * View frustum stored as six planes (xyz = normal, w = distance).
+ * Normals point inwards: a point p is inside when dot(n, p) + w >= 0
+ * for every plane.
+ */
+class Frustum {
+    public:
+        enum Side {
+            LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE,
+            PLANE_COUNT
+        };
+
+    private:
+        glm::vec4 _planes[PLANE_COUNT];
+
+    public:
+        Frustum();
+        explicit Frustum(const glm::mat4& viewProjection);
+
+        const glm::vec4& plane(int side) const;
+
+        bool containsPoint(const glm::vec3& p) const;
+        bool intersectsSphere(const glm::vec3& center, float radius) const;
+        bool intersectsSphere(const Sphere& sphere) const;
+        bool intersectsAabb(const AABB& box) const;
+};
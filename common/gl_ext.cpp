@@ -0,0 +1,55 @@
+#include "gl_ext.h"
+
+#include <cstring>
+
+GLEXT_MULTIDRAWARRAYSINDIRECTPROC glext::MultiDrawArraysIndirect = nullptr;
+GLEXT_MULTIDRAWELEMENTSINDIRECTPROC glext::MultiDrawElementsIndirect = nullptr;
+GLEXT_BUFFERSTORAGEPROC glext::BufferStorage = nullptr;
+GLEXT_MAXSHADERCOMPILERTHREADSPROC glext::MaxShaderCompilerThreads = nullptr;
+
+bool glext::multiDrawIndirect = false;
+bool glext::shaderStorageBuffer = false;
+bool glext::shaderDrawParameters = false;
+bool glext::bufferStorage = false;
+bool glext::parallelShaderCompile = false;
+
+bool glext::hasVersion(int major, int minor)
+{
+    return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+bool glext::hasExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for(GLint i = 0; i < count; i++) {
+        const char* ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if(ext && strcmp(ext, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+void glext::load(GLADloadproc loader)
+{
+    MultiDrawArraysIndirect = (GLEXT_MULTIDRAWARRAYSINDIRECTPROC)loader("glMultiDrawArraysIndirect");
+    MultiDrawElementsIndirect = (GLEXT_MULTIDRAWELEMENTSINDIRECTPROC)loader("glMultiDrawElementsIndirect");
+    BufferStorage = (GLEXT_BUFFERSTORAGEPROC)loader("glBufferStorage");
+
+    multiDrawIndirect = (hasVersion(4, 3) || hasExtension("GL_ARB_multi_draw_indirect")) &&
+                        MultiDrawArraysIndirect && MultiDrawElementsIndirect;
+    shaderStorageBuffer = hasVersion(4, 3) || hasExtension("GL_ARB_shader_storage_buffer_object");
+    // Core in 4.6 as gl_DrawID, the shaders use the ARB spelling which needs the extension
+    shaderDrawParameters = hasExtension("GL_ARB_shader_draw_parameters");
+    bufferStorage = (hasVersion(4, 4) || hasExtension("GL_ARB_buffer_storage")) && BufferStorage;
+
+    if(hasExtension("GL_KHR_parallel_shader_compile"))
+        MaxShaderCompilerThreads = (GLEXT_MAXSHADERCOMPILERTHREADSPROC)loader("glMaxShaderCompilerThreadsKHR");
+    else if(hasExtension("GL_ARB_parallel_shader_compile"))
+        MaxShaderCompilerThreads = (GLEXT_MAXSHADERCOMPILERTHREADSPROC)loader("glMaxShaderCompilerThreadsARB");
+    parallelShaderCompile = MaxShaderCompilerThreads != nullptr;
+
+    // Let the driver use as many compiler threads as it wants
+    if(parallelShaderCompile)
+        MaxShaderCompilerThreads(0xFFFFFFFF);
+}
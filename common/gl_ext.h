@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glad/glad.h>
+
+/*
+ * Entry points and enums newer than the GL 3.3 core profile glad was
+ * generated for. glext::load() must be called once glad is initialized;
+ * function pointers stay null and the feature flags false when the driver
+ * doesn't provide them.
+ */
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+#define GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT 0x90DF
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_DYNAMIC_STORAGE_BIT
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+#ifndef GL_COMPLETION_STATUS_ARB
+#define GL_COMPLETION_STATUS_ARB 0x91B1
+#endif
+
+typedef void (APIENTRYP GLEXT_MULTIDRAWARRAYSINDIRECTPROC)(GLenum mode,
+                                                            const void* indirect,
+                                                            GLsizei drawcount,
+                                                            GLsizei stride);
+typedef void (APIENTRYP GLEXT_MULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode,
+                                                              GLenum type,
+                                                              const void* indirect,
+                                                              GLsizei drawcount,
+                                                              GLsizei stride);
+typedef void (APIENTRYP GLEXT_BUFFERSTORAGEPROC)(GLenum target,
+                                                  GLsizeiptr size,
+                                                  const void* data,
+                                                  GLbitfield flags);
+typedef void (APIENTRYP GLEXT_MAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+
+namespace glext {
+    extern GLEXT_MULTIDRAWARRAYSINDIRECTPROC MultiDrawArraysIndirect;
+    extern GLEXT_MULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect;
+    extern GLEXT_BUFFERSTORAGEPROC BufferStorage;
+    extern GLEXT_MAXSHADERCOMPILERTHREADSPROC MaxShaderCompilerThreads;
+
+    extern bool multiDrawIndirect;          /* GL 4.3 or ARB_multi_draw_indirect */
+    extern bool shaderStorageBuffer;        /* GL 4.3 or ARB_shader_storage_buffer_object */
+    extern bool shaderDrawParameters;       /* ARB_shader_draw_parameters (gl_DrawIDARB) */
+    extern bool bufferStorage;              /* GL 4.4 or ARB_buffer_storage */
+    extern bool parallelShaderCompile;      /* ARB/KHR_parallel_shader_compile (GL_COMPLETION_STATUS_ARB) */
+
+    void load(GLADloadproc loader);
+    bool hasVersion(int major, int minor);
+    bool hasExtension(const char* name);
+}
@@ -0,0 +1,325 @@
+#include "glyph_atlas.h"
+#include "exception.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fmt/format.h>
+
+SkylinePacker::SkylinePacker(int width, int height)
+{
+    reset(width, height);
+}
+
+void SkylinePacker::reset(int width, int height)
+{
+    _width = width;
+    _height = height;
+    _skyline.reserve(std::max(width, 1));
+    reset();
+}
+
+void SkylinePacker::reset()
+{
+    _skyline.clear();
+    _skyline.push_back(Node{0, 0, _width});
+    _usedArea = 0;
+}
+
+// Height the rectangle would sit at if its left edge was on node index, -1 if it doesn't fit
+int SkylinePacker::fit(size_t index, int width, int height) const
+{
+    int x = _skyline[index].x;
+    if(x + width > _width)
+        return -1;
+
+    int y = 0;
+    int remaining = width;
+    for(size_t i = index; remaining > 0; i++) {
+        y = std::max(y, _skyline[i].y);
+        if(y + height > _height)
+            return -1;
+        remaining -= _skyline[i].width;
+    }
+    return y;
+}
+
+bool SkylinePacker::pack(int width, int height, int& x, int& y)
+{
+    int bestBottom = INT_MAX;
+    int bestWidth = INT_MAX;
+    int bestIndex = -1;
+    int bestY = 0;
+
+    for(size_t i = 0; i < _skyline.size(); i++) {
+        int top = fit(i, width, height);
+        if(top < 0)
+            continue;
+        if(top + height < bestBottom ||
+           (top + height == bestBottom && _skyline[i].width < bestWidth)) {
+            bestBottom = top + height;
+            bestWidth = _skyline[i].width;
+            bestIndex = (int)i;
+            bestY = top;
+        }
+    }
+    if(bestIndex < 0)
+        return false;
+
+    x = _skyline[bestIndex].x;
+    y = bestY;
+
+    // Raise the skyline under the new rectangle
+    _skyline.insert(_skyline.begin() + bestIndex, Node{x, y + height, width});
+    for(size_t i = bestIndex + 1; i < _skyline.size(); ) {
+        Node& prev = _skyline[i - 1];
+        Node& node = _skyline[i];
+        int overlap = prev.x + prev.width - node.x;
+        if(overlap <= 0)
+            break;
+        node.x += overlap;
+        node.width -= overlap;
+        if(node.width > 0)
+            break;
+        _skyline.erase(_skyline.begin() + i);
+    }
+
+    for(size_t i = 0; i + 1 < _skyline.size(); ) {
+        if(_skyline[i].y == _skyline[i + 1].y) {
+            _skyline[i].width += _skyline[i + 1].width;
+            _skyline.erase(_skyline.begin() + i + 1);
+        } else {
+            i++;
+        }
+    }
+
+    _usedArea += width * height;
+    return true;
+}
+
+float SkylinePacker::occupancy() const
+{
+    return _width && _height ? float(_usedArea) / (float(_width) * _height) : 0.0f;
+}
+
+GlyphAtlas::GlyphAtlas(const std::vector<unsigned char>& font,
+                       int width, int height,
+                       int pagesX, int pagesY):
+    _font(font),
+    _width(width),
+    _height(height),
+    _pageWidth(width / pagesX),
+    _pageHeight(height / pagesY),
+    _pixels((size_t)width * height, 0),
+    _frame(1),
+    _currentPage(0),
+    _dirtyX0(0), _dirtyY0(0), _dirtyX1(0), _dirtyY1(0),
+    _stats{}
+{
+    if(!stbtt_InitFont(&_info, _font.data(), stbtt_GetFontOffsetForIndex(_font.data(), 0)))
+        throw Exception("Invalid font data");
+
+    _pages.resize(pagesX * pagesY);
+    for(int i = 0; i < (int)_pages.size(); i++) {
+        Page& page = _pages[i];
+        page.x = (i % pagesX) * _pageWidth;
+        page.y = (i / pagesX) * _pageHeight;
+        page.packer.reset(_pageWidth, _pageHeight);
+        page.lastUsed = 0;
+        resetPage(i);
+    }
+    _glyphs.reserve(1024);
+}
+
+void GlyphAtlas::beginFrame()
+{
+    _frame++;
+    _stats = {};
+}
+
+void GlyphAtlas::resetPage(int index)
+{
+    Page& page = _pages[index];
+    for(uint64_t key : page.keys)
+        _glyphs.erase(key);
+    page.keys.clear();
+    page.packer.reset();
+
+    for(int y = 0; y < _pageHeight; y++)
+        memset(&_pixels[(size_t)(page.y + y) * _width + page.x], 0, _pageWidth);
+    markDirty(page.x, page.y, _pageWidth, _pageHeight);
+
+    // Opaque block for solid rectangles
+    int x, y;
+    place(page, 2, 2, x, y);
+    for(int dy = 0; dy < 2; dy++)
+        for(int dx = 0; dx < 2; dx++)
+            _pixels[(size_t)(y + dy) * _width + x + dx] = 255;
+    page.whiteU = (x + 1.0f) / _width;
+    page.whiteV = (y + 1.0f) / _height;
+}
+
+bool GlyphAtlas::place(Page& page, int width, int height, int& x, int& y)
+{
+    if(!page.packer.pack(width + PADDING, height + PADDING, x, y))
+        return false;
+    x += page.x;
+    y += page.y;
+    return true;
+}
+
+void GlyphAtlas::markDirty(int x, int y, int width, int height)
+{
+    if(!dirty()) {
+        _dirtyX0 = x;
+        _dirtyY0 = y;
+        _dirtyX1 = x + width;
+        _dirtyY1 = y + height;
+        return;
+    }
+    _dirtyX0 = std::min(_dirtyX0, x);
+    _dirtyY0 = std::min(_dirtyY0, y);
+    _dirtyX1 = std::max(_dirtyX1, x + width);
+    _dirtyY1 = std::max(_dirtyY1, y + height);
+}
+
+const glyph_entry* GlyphAtlas::glyph(uint32_t codepoint, int pixelHeight)
+{
+    uint64_t key = ((uint64_t)pixelHeight << 32) | codepoint;
+    auto it = _glyphs.find(key);
+    if(it != _glyphs.end()) {
+        if(it->second.page >= 0)
+            _pages[it->second.page].lastUsed = _frame;
+        _stats.hits++;
+        return &it->second;
+    }
+
+    float scale = stbtt_ScaleForPixelHeight(&_info, (float)pixelHeight);
+    int x0, y0, x1, y1;
+    stbtt_GetCodepointBitmapBox(&_info, codepoint, scale, scale, &x0, &y0, &x1, &y1);
+    int advance, leftBearing;
+    stbtt_GetCodepointHMetrics(&_info, codepoint, &advance, &leftBearing);
+
+    glyph_entry entry = {};
+    entry.page = -1;
+    entry.advance = advance * scale;
+
+    int width = x1 - x0;
+    int height = y1 - y0;
+    if(width > 0 && height > 0) {
+        if(width + PADDING > _pageWidth || height + PADDING > _pageHeight) {
+            _stats.dropped++;
+            return nullptr;
+        }
+
+        // Current page first, then any page with room, then evict the least recently used
+        int x = 0, y = 0;
+        int pageIndex = -1;
+        if(place(_pages[_currentPage], width, height, x, y)) {
+            pageIndex = _currentPage;
+        } else {
+            for(int i = 0; i < (int)_pages.size() && pageIndex < 0; i++) {
+                if(i != _currentPage && place(_pages[i], width, height, x, y))
+                    pageIndex = i;
+            }
+        }
+        if(pageIndex < 0) {
+            int lru = -1;
+            for(int i = 0; i < (int)_pages.size(); i++) {
+                if(_pages[i].lastUsed < _frame && (lru < 0 || _pages[i].lastUsed < _pages[lru].lastUsed))
+                    lru = i;
+            }
+            if(lru < 0) {
+                _stats.dropped++;
+                return nullptr;
+            }
+            resetPage(lru);
+            _stats.evictions++;
+            if(!place(_pages[lru], width, height, x, y)) {
+                _stats.dropped++;
+                return nullptr;
+            }
+            pageIndex = lru;
+        }
+
+        stbtt_MakeCodepointBitmap(&_info, &_pixels[(size_t)y * _width + x],
+                                  width, height, _width,
+                                  scale, scale, codepoint);
+        markDirty(x, y, width, height);
+
+        Page& page = _pages[pageIndex];
+        page.keys.push_back(key);
+        page.lastUsed = _frame;
+        _currentPage = pageIndex;
+
+        entry.page = pageIndex;
+        entry.u0 = (float)x / _width;
+        entry.v0 = (float)y / _height;
+        entry.u1 = (float)(x + width) / _width;
+        entry.v1 = (float)(y + height) / _height;
+        entry.x0 = (float)x0;
+        entry.y0 = (float)y0;
+        entry.x1 = (float)x1;
+        entry.y1 = (float)y1;
+    }
+
+    _stats.misses++;
+    return &(_glyphs[key] = entry);
+}
+
+void GlyphAtlas::white(float& u, float& v)
+{
+    _pages[0].lastUsed = _frame;
+    u = _pages[0].whiteU;
+    v = _pages[0].whiteV;
+}
+
+float GlyphAtlas::ascent(int pixelHeight) const
+{
+    int ascent, descent, lineGap;
+    stbtt_GetFontVMetrics(&_info, &ascent, &descent, &lineGap);
+    return ascent * stbtt_ScaleForPixelHeight(&_info, (float)pixelHeight);
+}
+
+const unsigned char* GlyphAtlas::pixels() const
+{
+    return _pixels.data();
+}
+
+int GlyphAtlas::width() const
+{
+    return _width;
+}
+
+int GlyphAtlas::height() const
+{
+    return _height;
+}
+
+int GlyphAtlas::pageCount() const
+{
+    return (int)_pages.size();
+}
+
+bool GlyphAtlas::dirty() const
+{
+    return _dirtyX1 > _dirtyX0 && _dirtyY1 > _dirtyY0;
+}
+
+void GlyphAtlas::dirtyRect(int& x, int& y, int& width, int& height) const
+{
+    x = _dirtyX0;
+    y = _dirtyY0;
+    width = _dirtyX1 - _dirtyX0;
+    height = _dirtyY1 - _dirtyY0;
+}
+
+void GlyphAtlas::clearDirty()
+{
+    _dirtyX0 = _dirtyY0 = _dirtyX1 = _dirtyY1 = 0;
+}
+
+const glyph_atlas_stats& GlyphAtlas::stats() const
+{
+    return _stats;
+}
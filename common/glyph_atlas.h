@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "stb_truetype.h"
+
+// Bottom-left skyline rectangle packer
+class SkylinePacker {
+    private:
+        struct Node {
+            int x, y, width;
+        };
+
+        int _width, _height;
+        std::vector<Node> _skyline;
+        int _usedArea;
+
+    public:
+        SkylinePacker(int width = 0, int height = 0);
+
+        void reset(int width, int height);
+        void reset();
+
+        // False when the rectangle doesn't fit
+        bool pack(int width, int height, int& x, int& y);
+
+        float occupancy() const;
+
+    private:
+        int fit(size_t index, int width, int height) const;
+};
+
+struct glyph_entry {
+    int page;
+    float u0, v0, u1, v1;
+    float x0, y0, x1, y1;       /* Quad relative to the pen position, y down */
+    float advance;
+};
+
+struct glyph_atlas_stats {
+    unsigned hits;
+    unsigned misses;            /* Glyphs rasterized */
+    unsigned evictions;         /* Pages flushed to make room */
+    unsigned dropped;           /* Glyphs that could not be placed this frame */
+};
+
+/*
+ * Glyph cache in a single channel texture.
+ *
+ * Glyphs are rasterized with stb_truetype on first use at a given pixel
+ * size and skyline packed into one of the pages the atlas is divided in.
+ * When no page has room, the least recently used page is cleared along
+ * with all its glyphs. Pages used during the current frame are never
+ * evicted, so quads already emitted stay valid; a glyph that can't be
+ * placed then is dropped for the frame.
+ *
+ * This class only touches CPU memory: pixels() and the dirty rectangle
+ * tell the renderer what to upload.
+ */
+class GlyphAtlas {
+    public:
+        static const int PADDING = 1;
+
+    private:
+        struct Page {
+            int x, y;                       /* Origin in the atlas */
+            SkylinePacker packer;
+            uint64_t lastUsed;
+            std::vector<uint64_t> keys;     /* Glyphs to forget on eviction */
+            float whiteU, whiteV;
+        };
+
+        std::vector<unsigned char> _font;
+        stbtt_fontinfo _info;
+        int _width, _height;
+        int _pageWidth, _pageHeight;
+        std::vector<unsigned char> _pixels;
+        std::vector<Page> _pages;
+        std::unordered_map<uint64_t, glyph_entry> _glyphs;
+        uint64_t _frame;
+        int _currentPage;
+        int _dirtyX0, _dirtyY0, _dirtyX1, _dirtyY1;
+        glyph_atlas_stats _stats;
+
+    public:
+        GlyphAtlas(const std::vector<unsigned char>& font,
+                   int width = 1024, int height = 1024,
+                   int pagesX = 2, int pagesY = 2);
+
+        GlyphAtlas(const GlyphAtlas&) = delete;
+        GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+        // Advances the LRU clock and resets the per-frame stats
+        void beginFrame();
+
+        // Null when the glyph could not be placed this frame
+        const glyph_entry* glyph(uint32_t codepoint, int pixelHeight);
+
+        // Texture coordinates of an opaque texel, for solid rectangles
+        void white(float& u, float& v);
+
+        float ascent(int pixelHeight) const;
+
+        const unsigned char* pixels() const;
+        int width() const;
+        int height() const;
+        int pageCount() const;
+
+        bool dirty() const;
+        void dirtyRect(int& x, int& y, int& width, int& height) const;
+        void clearDirty();
+
+        const glyph_atlas_stats& stats() const;
+
+    private:
+        void resetPage(int index);
+        bool place(Page& page, int width, int height, int& x, int& y);
+        void markDirty(int x, int y, int width, int height);
+};
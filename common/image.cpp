@@ -1,13 +1,19 @@
 #include "image.h"
 #include "stb_image.h"
 #include "exception.h"
+#include "trace.h"
 #include <fmt/printf.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
 Image::Image(std::string filename, bool flip):
     _filename(filename)
 {
-    stbi_set_flip_vertically_on_load(flip);
+    TRACE_SCOPE("Image::Image");
 
+    // stb_image's flip flag is global, flip here so images can be decoded on any thread
     int width, height, nrChannels;
     unsigned char *data = stbi_load(filename.c_str(), 
                                     &width, &height, 
@@ -17,6 +23,12 @@ Image::Image(std::string filename, bool flip):
         throw Exception(fmt::format("Failed to load image\"{}\"", filename));
     }
 
+    if(flip) {
+        size_t stride = (size_t)width * nrChannels;
+        for(int y = 0; y < height / 2; y++)
+            std::swap_ranges(data + y * stride, data + (y + 1) * stride, data + (height - 1 - y) * stride);
+    }
+
     _width = width;
     _height = height;
     _channels = nrChannels;
@@ -49,3 +61,108 @@ int Image::getChannels() const
 }
 
 
+static uint32_t crc32(uint32_t crc, const unsigned char* data, size_t size)
+{
+    static uint32_t table[256];
+    static bool tableInit = false;
+    if(!tableInit) {
+        for(uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for(int k = 0; k < 8; k++)
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        tableInit = true;
+    }
+
+    crc = ~crc;
+    for(size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void putU32(std::vector<unsigned char>& out, uint32_t value)
+{
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+static void putChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data)
+{
+    putU32(out, data.size());
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    putU32(out, crc32(0, &out[start], out.size() - start));
+}
+
+void writePng(const std::string& filename,
+              const unsigned char* data,
+              int width, int height, int channels,
+              bool flip)
+{
+    static const unsigned char colorTypes[] = { 0, 0, 4, 2, 6 };
+    if(channels < 1 || channels > 4)
+        throw Exception(fmt::format("Cannot write {} channel image \"{}\"", channels, filename));
+
+    // Filter-less scanlines, each prefixed with filter type 0
+    size_t stride = (size_t)width * channels;
+    std::vector<unsigned char> raw;
+    raw.reserve((stride + 1) * height);
+    for(int y = 0; y < height; y++) {
+        const unsigned char* row = data + stride * (flip ? height - 1 - y : y);
+        raw.push_back(0);
+        raw.insert(raw.end(), row, row + stride);
+    }
+
+    // zlib stream made of stored deflate blocks
+    std::vector<unsigned char> zlib;
+    zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    size_t pos = 0;
+    do {
+        size_t len = std::min(raw.size() - pos, (size_t)65535);
+        bool last = pos + len == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(len & 0xFF);
+        zlib.push_back(len >> 8);
+        zlib.push_back(~len & 0xFF);
+        zlib.push_back((~len >> 8) & 0xFF);
+        zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + len);
+        pos += len;
+    } while(pos < raw.size());
+
+    uint32_t a = 1, b = 0;
+    for(unsigned char c : raw) {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    putU32(zlib, (b << 16) | a);
+
+    std::vector<unsigned char> header;
+    putU32(header, width);
+    putU32(header, height);
+    header.push_back(8);
+    header.push_back(colorTypes[channels]);
+    header.push_back(0);
+    header.push_back(0);
+    header.push_back(0);
+
+    static const unsigned char signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::vector<unsigned char> png(signature, signature + sizeof(signature));
+    putChunk(png, "IHDR", header);
+    putChunk(png, "IDAT", zlib);
+    putChunk(png, "IEND", std::vector<unsigned char>());
+
+    FILE* f = fopen(filename.c_str(), "wb");
+    if(!f)
+        throw Exception(fmt::format("Failed to open \"{}\" for writing", filename));
+    size_t written = fwrite(png.data(), 1, png.size(), f);
+    fclose(f);
+    if(written != png.size())
+        throw Exception(fmt::format("Failed to write \"{}\"", filename));
+}
+
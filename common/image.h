@@ -21,3 +21,8 @@ class Image {
         int _channels;
 };
 
+// Write 8-bit pixels as an uncompressed PNG, rows top to bottom unless flip
+void writePng(const std::string& filename,
+              const unsigned char* data,
+              int width, int height, int channels,
+              bool flip = false);
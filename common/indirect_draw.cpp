@@ -0,0 +1,182 @@
+#include "indirect_draw.h"
+#include "gl_ext.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "context.h"
+#include "shader.h"
+
+IndirectBatch::IndirectBatch():
+    _capacity(0),
+    _forceFallback(false),
+    _programGeneration(Shader::programGeneration()),
+    _stats{}
+{
+}
+
+IndirectBatch::~IndirectBatch()
+{
+}
+
+bool IndirectBatch::supported()
+{
+    return glext::multiDrawIndirect &&
+           glext::shaderStorageBuffer &&
+           glext::shaderDrawParameters;
+}
+
+void IndirectBatch::setForceFallback(bool force)
+{
+    _forceFallback = force;
+}
+
+bool IndirectBatch::indirect() const
+{
+    return !_forceFallback && supported();
+}
+
+void IndirectBatch::clear()
+{
+    _arrays.clear();
+    _elements.clear();
+    _models.clear();
+    _stats = {};
+}
+
+void IndirectBatch::reserve(size_t count)
+{
+    _arrays.reserve(count);
+    _elements.reserve(count);
+    _models.reserve(count);
+}
+
+void IndirectBatch::add(GLuint count, GLuint first, const glm::mat4& model)
+{
+    assert(_elements.empty());
+    _arrays.push_back(DrawArraysIndirectCommand{count, 1, first, 0});
+    _models.push_back(model);
+}
+
+void IndirectBatch::addIndexed(GLuint count, GLuint firstIndex, GLint baseVertex, const glm::mat4& model)
+{
+    assert(_arrays.empty());
+    _elements.push_back(DrawElementsIndirectCommand{count, 1, firstIndex, baseVertex, 0});
+    _models.push_back(model);
+}
+
+void IndirectBatch::submit(GLenum mode, GLenum indexType)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    _stats.draws = (unsigned)_models.size();
+    if(!_models.empty()) {
+        if(indirect())
+            submitIndirect(mode, indexType);
+        else
+            submitFallback(mode, indexType);
+    }
+
+    _stats.submitTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void IndirectBatch::reserveBuffers(size_t count)
+{
+    if(count <= _capacity)
+        return;
+
+    // Replaced buffers stay alive in the driver until the GPU is done with them
+    _capacity = std::max(count, _capacity * 2);
+    _commandBuffer.reset(new StreamBuffer(GL_DRAW_INDIRECT_BUFFER,
+                                          _capacity * sizeof(DrawElementsIndirectCommand)));
+    _modelBuffer.reset(new StreamBuffer(GL_SHADER_STORAGE_BUFFER,
+                                        _capacity * sizeof(glm::mat4) + 256));
+}
+
+void IndirectBatch::submitIndirect(GLenum mode, GLenum indexType)
+{
+    static GLint ssboAlignment = 0;
+    if(!ssboAlignment)
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &ssboAlignment);
+
+    reserveBuffers(_models.size());
+    unsigned stalls = _modelBuffer->stats().stalls + _commandBuffer->stats().stalls;
+
+    size_t modelSize = _models.size() * sizeof(glm::mat4);
+    size_t modelOffset = _modelBuffer->write(_models.data(), modelSize, ssboAlignment);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, MODEL_BINDING, _modelBuffer->id(), modelOffset, modelSize);
+
+    size_t commandOffset;
+    if(!_arrays.empty())
+        commandOffset = _commandBuffer->write(_arrays.data(), _arrays.size() * sizeof(DrawArraysIndirectCommand), 4);
+    else
+        commandOffset = _commandBuffer->write(_elements.data(), _elements.size() * sizeof(DrawElementsIndirectCommand), 4);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer->id());
+    if(!_arrays.empty())
+        glext::MultiDrawArraysIndirect(mode, BUFFER_OBJECT(commandOffset), (GLsizei)_arrays.size(), 0);
+    else
+        glext::MultiDrawElementsIndirect(mode, indexType, BUFFER_OBJECT(commandOffset), (GLsizei)_elements.size(), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    _modelBuffer->endFrame();
+    _commandBuffer->endFrame();
+
+    _stats.drawCalls = 1;
+    _stats.bufferStalls = _modelBuffer->stats().stalls + _commandBuffer->stats().stalls - stalls;
+}
+
+void IndirectBatch::submitFallback(GLenum mode, GLenum indexType)
+{
+    GLint program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+    GLint location = modelLocation((unsigned)program);
+
+    size_t indexSize = indexType == GL_UNSIGNED_BYTE ? 1 :
+                       indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+
+    for(size_t i = 0; i < _models.size(); i++) {
+        if(location != -1) {
+            glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(_models[i]));
+            _stats.uniformUpdates++;
+        }
+
+        if(!_arrays.empty()) {
+            const auto& cmd = _arrays[i];
+            glDrawArrays(mode, cmd.first, cmd.count);
+        } else {
+            const auto& cmd = _elements[i];
+            glDrawElementsBaseVertex(mode, cmd.count, indexType,
+                                     BUFFER_OBJECT(cmd.firstIndex * indexSize),
+                                     cmd.baseVertex);
+        }
+    }
+
+    _stats.drawCalls = (unsigned)_models.size();
+}
+
+int IndirectBatch::modelLocation(unsigned program)
+{
+    // Program names get reused once deleted, e.g. by a shader reload
+    if(_programGeneration != Shader::programGeneration()) {
+        _modelLocations.clear();
+        _programGeneration = Shader::programGeneration();
+    }
+
+    auto it = _modelLocations.find(program);
+    if(it == _modelLocations.end())
+        it = _modelLocations.insert(std::make_pair(program, glGetUniformLocation(program, "model"))).first;
+    return it->second;
+}
+
+size_t IndirectBatch::size() const
+{
+    return _models.size();
+}
+
+const IndirectBatchStats& IndirectBatch::stats() const
+{
+    return _stats;
+}
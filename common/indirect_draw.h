@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "stream_buffer.h"
+
+// Layouts mandated by the GL spec for indirect draws
+struct DrawArraysIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint first;
+    GLuint baseInstance;
+};
+
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+struct IndirectBatchStats {
+    unsigned draws;             /* Draws in the batch */
+    unsigned drawCalls;         /* GL draw calls actually issued */
+    double submitTime;          /* CPU time spent in submit(), seconds */
+    unsigned bufferStalls;      /* Waits on the GPU for a free stream buffer region */
+    unsigned uniformUpdates;    /* Model matrix uploads of the fallback path */
+};
+
+/*
+ * Batch of draws sharing a program and a VAO.
+ *
+ * When the driver supports multi-draw indirect, SSBOs and gl_DrawID, the
+ * commands are packed into a GL_DRAW_INDIRECT_BUFFER and the model
+ * matrices into an SSBO (binding MODEL_BINDING, indexed by gl_DrawID in the
+ * vertex shader) and everything goes out in one glMultiDraw*Indirect call.
+ * Both live in StreamBuffers sized for the largest batch seen so far, so a
+ * batch must be submitted at most once per frame.
+ * Otherwise submit() falls back to one draw per command with the matrix
+ * uploaded to the "model" uniform, so the same batch works with the
+ * regular shaders.
+ *
+ * A batch holds either array or indexed draws, not both.
+ */
+class IndirectBatch {
+    public:
+        static const GLuint MODEL_BINDING = 0;
+
+    private:
+        std::vector<DrawArraysIndirectCommand> _arrays;
+        std::vector<DrawElementsIndirectCommand> _elements;
+        std::vector<glm::mat4> _models;
+        std::unique_ptr<StreamBuffer> _commandBuffer;
+        std::unique_ptr<StreamBuffer> _modelBuffer;
+        size_t _capacity;
+        bool _forceFallback;
+        std::unordered_map<unsigned, int> _modelLocations;  /* Fallback path, see RenderQueue */
+        unsigned _programGeneration;
+        IndirectBatchStats _stats;
+
+    public:
+        IndirectBatch();
+        ~IndirectBatch();
+
+        IndirectBatch(const IndirectBatch&) = delete;
+        IndirectBatch& operator=(const IndirectBatch&) = delete;
+
+        // True when the driver has what the indirect path needs
+        static bool supported();
+
+        // Per-draw submission even where the indirect path is supported,
+        // to compare the two
+        void setForceFallback(bool force);
+        bool indirect() const;      /* True when submit() uses the indirect path */
+
+        void clear();
+        void reserve(size_t count);
+        void add(GLuint count, GLuint first, const glm::mat4& model);
+        void addIndexed(GLuint count, GLuint firstIndex, GLint baseVertex, const glm::mat4& model);
+
+        // The program and VAO (with its element buffer) must be bound
+        void submit(GLenum mode, GLenum indexType = GL_UNSIGNED_INT);
+
+        size_t size() const;
+        const IndirectBatchStats& stats() const;
+
+    private:
+        void reserveBuffers(size_t count);
+        void submitIndirect(GLenum mode, GLenum indexType);
+        void submitFallback(GLenum mode, GLenum indexType);
+        int modelLocation(unsigned program);
+};
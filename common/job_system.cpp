@@ -0,0 +1,264 @@
+#include "job_system.h"
+
+#include <fmt/format.h>
+
+#include "trace.h"
+
+const int JobSystem::DEQUE_SIZE;
+const int JobSystem::POOL_SIZE;
+const int JobSystem::SPIN_COUNT;
+const int JobSystem::SPLIT_THRESHOLD;
+
+static thread_local const JobSystem* currentSystem = nullptr;
+static thread_local int currentIndex = -1;
+
+JobSystem::Worker::Worker():
+    deque(DEQUE_SIZE),
+    pool(new Job[POOL_SIZE]),
+    nextJob(0),
+    random(0x9E3779B9)
+{
+    for(int i = 0; i < POOL_SIZE; i++)
+        pool[i].busy = false;
+}
+
+JobSystem::JobSystem(int threadCount):
+    _quit(false),
+    _sleeping(0),
+    _queueSize(0),
+    _mainQueueSize(0)
+{
+    if(threadCount <= 0)
+        threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+
+    for(int i = 0; i < threadCount; i++) {
+        _workers.emplace_back(new Worker);
+        _workers.back()->random += i;
+    }
+
+    currentSystem = this;
+    currentIndex = 0;
+    for(int i = 1; i < threadCount; i++)
+        _threads.emplace_back(&JobSystem::workerMain, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    _quit = true;
+    for(size_t i = 0; i < _threads.size(); i++)
+        _wakeup.signal();
+    for(auto& thread : _threads)
+        thread.join();
+
+    if(currentSystem == this) {
+        currentSystem = nullptr;
+        currentIndex = -1;
+    }
+    for(Job* job : _queue) {
+        if(!job->pooled)
+            delete job;
+    }
+    for(Job* job : _mainQueue) {
+        if(!job->pooled)
+            delete job;
+    }
+}
+
+JobSystem& JobSystem::instance()
+{
+    static JobSystem system;
+    return system;
+}
+
+int JobSystem::currentWorker() const
+{
+    return currentSystem == this ? currentIndex : -1;
+}
+
+int JobSystem::threadCount() const
+{
+    return (int)_workers.size();
+}
+
+bool JobSystem::isMainThread() const
+{
+    return currentWorker() == 0;
+}
+
+// Pool slots are only reused once their job is done, a busy one means
+// that many jobs are still in flight and a heap job takes its place
+JobSystem::Job* JobSystem::allocate()
+{
+    int index = currentWorker();
+    if(index >= 0) {
+        Worker& worker = *_workers[index];
+        Job* job = &worker.pool[worker.nextJob++ & (POOL_SIZE - 1)];
+        if(!job->busy.load(std::memory_order_acquire)) {
+            job->busy.store(true, std::memory_order_relaxed);
+            job->pooled = true;
+            return job;
+        }
+    }
+    Job* job = new Job;
+    job->busy = true;
+    job->pooled = false;
+    return job;
+}
+
+void JobSystem::submit(Job* job)
+{
+    int index = currentWorker();
+    if(index < 0 || !_workers[index]->deque.push(job)) {
+        if(index >= 0 && !job->dependency) {
+            // Deque full, better run it now than queue it behind everything
+            execute(job);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        _queue.push_back(job);
+        _queueSize++;
+    }
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(_sleeping.load(std::memory_order_relaxed) > 0)
+        _wakeup.signal();
+}
+
+// Returns false if the job still waits on its dependency. Those go to the
+// back of the shared queue so whatever they depend on gets its turn.
+bool JobSystem::execute(Job* job)
+{
+    if(job->dependency && !job->dependency->done()) {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        _queue.push_back(job);
+        _queueSize++;
+        return false;
+    }
+
+    job->function(job);
+
+    // The counter may go away as soon as it reaches zero, touch it last
+    JobCounter* counter = job->counter;
+    if(job->pooled)
+        job->busy.store(false, std::memory_order_release);
+    else
+        delete job;
+    if(counter && counter->_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        if(_queueSize.load(std::memory_order_relaxed) > 0 && _sleeping.load(std::memory_order_relaxed) > 0)
+            _wakeup.signal();
+    }
+    return true;
+}
+
+JobSystem::Job* JobSystem::steal(int worker)
+{
+    size_t count = _workers.size();
+    size_t start = 0;
+    if(worker >= 0) {
+        // xorshift, the victim order only needs to differ between threads
+        unsigned& random = _workers[worker]->random;
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        start = random % count;
+    }
+    for(size_t i = 0; i < count; i++) {
+        size_t victim = (start + i) % count;
+        if((int)victim == worker)
+            continue;
+        Job* job = _workers[victim]->deque.steal();
+        if(job)
+            return job;
+    }
+    return nullptr;
+}
+
+bool JobSystem::runOne(int worker)
+{
+    Job* job = nullptr;
+    if(worker >= 0)
+        job = _workers[worker]->deque.pop();
+
+    if(!job && worker == 0 && _mainQueueSize.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        if(!_mainQueue.empty()) {
+            job = _mainQueue.front();
+            _mainQueue.pop_front();
+            _mainQueueSize--;
+        }
+    }
+
+    if(!job && _queueSize.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(_queueMutex);
+        if(!_queue.empty()) {
+            job = _queue.front();
+            _queue.pop_front();
+            _queueSize--;
+        }
+    }
+
+    if(!job)
+        job = steal(worker);
+    return job && execute(job);
+}
+
+void JobSystem::wait(const JobCounter& counter)
+{
+    TRACE_SCOPE("JobSystem::wait");
+    int worker = currentWorker();
+    while(!counter.done()) {
+        if(!runOne(worker))
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::runMainThreadJobs()
+{
+    if(!isMainThread())
+        return;
+    while(_mainQueueSize.load(std::memory_order_relaxed) > 0) {
+        Job* job;
+        {
+            std::lock_guard<std::mutex> lock(_queueMutex);
+            if(_mainQueue.empty())
+                break;
+            job = _mainQueue.front();
+            _mainQueue.pop_front();
+            _mainQueueSize--;
+        }
+        execute(job);
+    }
+}
+
+size_t JobSystem::localJobs() const
+{
+    int index = currentWorker();
+    return index >= 0 ? _workers[index]->deque.size() : 0;
+}
+
+void JobSystem::workerMain(int worker)
+{
+    TRACE_THREAD_NAME(fmt::format("job worker {}", worker));
+    currentSystem = this;
+    currentIndex = worker;
+
+    int idle = 0;
+    while(!_quit) {
+        if(runOne(worker)) {
+            idle = 0;
+            continue;
+        }
+        if(++idle < SPIN_COUNT) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Announce the nap first, then look once more: a submit after
+        // that sees _sleeping and signals
+        _sleeping.fetch_add(1, std::memory_order_seq_cst);
+        if(!runOne(worker) && !_quit)
+            _wakeup.wait();
+        _sleeping.fetch_sub(1, std::memory_order_relaxed);
+        idle = 0;
+    }
+}
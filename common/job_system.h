@@ -0,0 +1,211 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "semaphore.h"
+#include "work_stealing_deque.h"
+
+// Outstanding jobs, see JobSystem::run and JobSystem::wait
+class JobCounter {
+    private:
+        std::atomic<int> _count;
+
+        friend class JobSystem;
+
+    public:
+        JobCounter():
+            _count(0)
+        {
+        }
+
+        JobCounter(const JobCounter&) = delete;
+        JobCounter& operator=(const JobCounter&) = delete;
+
+        bool done() const
+        {
+            return _count.load(std::memory_order_acquire) == 0;
+        }
+};
+
+/*
+ * Work-stealing job scheduler.
+ *
+ * Every thread of the system, the one that created it included, has a
+ * Chase-Lev deque: jobs spawned from a thread go to its own deque, idle
+ * threads steal from the others and sleep once there is nothing left.
+ * Jobs spawned from other threads, and jobs waiting on a dependency, go
+ * through a shared FIFO queue instead.
+ *
+ * Jobs are small callables copied into a pooled Job, no allocation on
+ * the common path. A JobCounter counts the jobs spawned against it, and
+ * wait() runs other jobs until it drops to zero rather than blocking, so
+ * jobs can wait on jobs. runOnMainThread() queues jobs, e.g. GL calls,
+ * that only the creating thread runs: from runMainThreadJobs() or while
+ * it waits.
+ */
+class JobSystem {
+    public:
+        static const int DEQUE_SIZE = 4096;
+        static const int POOL_SIZE = 4096;      /* Jobs per thread, reused round robin */
+        static const int SPIN_COUNT = 64;       /* Failed steals before a worker sleeps */
+        static const int SPLIT_THRESHOLD = 2;   /* parallelFor splits while the deque is this short */
+
+        struct Job {
+            static const size_t PAYLOAD_SIZE = 96;
+
+            void (*function)(Job*);
+            JobCounter* counter;
+            const JobCounter* dependency;
+            std::atomic<bool> busy;
+            bool pooled;
+            std::aligned_storage<PAYLOAD_SIZE, 16>::type payload;
+        };
+
+    private:
+        struct Worker {
+            WorkStealingDeque<Job> deque;
+            std::unique_ptr<Job[]> pool;
+            size_t nextJob;
+            unsigned random;                    /* Picks steal victims */
+
+            Worker();
+        };
+
+        std::vector<std::unique_ptr<Worker>> _workers;     /* 0 is the creating thread */
+        std::vector<std::thread> _threads;
+        std::atomic<bool> _quit;
+        std::atomic<int> _sleeping;
+        Semaphore _wakeup;
+
+        std::mutex _queueMutex;
+        std::deque<Job*> _queue;                /* From other threads, and requeued jobs */
+        std::atomic<int> _queueSize;
+        std::deque<Job*> _mainQueue;            /* Main thread affinity */
+        std::atomic<int> _mainQueueSize;
+
+        template<typename F>
+        static void invoke(Job* job)
+        {
+            F* function = reinterpret_cast<F*>(&job->payload);
+            (*function)();
+            function->~F();
+        }
+
+        template<typename F>
+        Job* makeJob(F&& function, JobCounter* counter, const JobCounter* dependency)
+        {
+            typedef typename std::decay<F>::type Function;
+            static_assert(sizeof(Function) <= Job::PAYLOAD_SIZE, "Job captures too much, capture a pointer instead");
+            static_assert(std::alignment_of<Function>::value <= 16, "Job alignment not supported");
+
+            Job* job = allocate();
+            new(&job->payload) Function(std::forward<F>(function));
+            job->function = &invoke<Function>;
+            job->counter = counter;
+            job->dependency = dependency;
+            if(counter)
+                counter->_count.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+
+        template<typename F>
+        struct ForRange {
+            JobSystem* system;
+            const F* function;
+            size_t grain;
+            JobCounter* counter;
+        };
+
+        // Lazy binary splitting: hands half the range out whenever this
+        // thread's deque runs low, meaning other threads may be idle
+        template<typename F>
+        static void forRange(const ForRange<F>& range, size_t begin, size_t end)
+        {
+            while(begin < end) {
+                if(end - begin > range.grain && range.system->localJobs() < SPLIT_THRESHOLD) {
+                    size_t middle = begin + (end - begin) / 2;
+                    ForRange<F> copy = range;
+                    range.system->run([copy, middle, end] { forRange(copy, middle, end); }, range.counter);
+                    end = middle;
+                    continue;
+                }
+                size_t chunk = std::min(end, begin + range.grain);
+                for(size_t i = begin; i < chunk; i++)
+                    (*range.function)(i);
+                begin = chunk;
+            }
+        }
+
+    public:
+        // threadCount counts the calling thread, 0 for one per core
+        explicit JobSystem(int threadCount = 0);
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        // Created on first use, from the main thread
+        static JobSystem& instance();
+
+        // Runs function() on any thread, once dependency (if any) is done
+        template<typename F>
+        void run(F&& function, JobCounter* counter = nullptr, const JobCounter* dependency = nullptr)
+        {
+            submit(makeJob(std::forward<F>(function), counter, dependency));
+        }
+
+        // Runs function() on the thread that created the system
+        template<typename F>
+        void runOnMainThread(F&& function, JobCounter* counter = nullptr)
+        {
+            Job* job = makeJob(std::forward<F>(function), counter, nullptr);
+            std::lock_guard<std::mutex> lock(_queueMutex);
+            _mainQueue.push_back(job);
+            _mainQueueSize++;
+        }
+
+        // function(i) for every i in [begin, end), returns when all are done.
+        // grain is the smallest range run as one piece, 0 picks one.
+        template<typename F>
+        void parallelFor(size_t begin, size_t end, const F& function, size_t grain = 0)
+        {
+            if(begin >= end)
+                return;
+            if(!grain)
+                grain = std::max<size_t>(1, (end - begin) / (threadCount() * 32));
+
+            JobCounter counter;
+            ForRange<F> range = { this, &function, grain, &counter };
+            forRange(range, begin, end);
+            wait(counter);
+        }
+
+        // Runs other jobs until counter is done
+        void wait(const JobCounter& counter);
+
+        // Main thread, once per frame
+        void runMainThreadJobs();
+
+        int threadCount() const;
+        bool isMainThread() const;
+
+    private:
+        Job* allocate();
+        void submit(Job* job);
+        bool execute(Job* job);
+        bool runOne(int worker);
+        Job* steal(int worker);
+        size_t localJobs() const;
+        int currentWorker() const;
+        void workerMain(int worker);
+};
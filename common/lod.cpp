@@ -0,0 +1,91 @@
+#include "lod.h"
+#include "camera.h"
+#include "mesh_simplify.h"
+
+#include <algorithm>
+#include <cmath>
+
+std::vector<MeshLod> buildLodChain(const MeshData& mesh,
+                                   int maxLevels,
+                                   float ratio,
+                                   size_t minTriangles)
+{
+    std::vector<MeshLod> lods;
+    lods.push_back(MeshLod{mesh, 0.0f});
+
+    while((int)lods.size() < maxLevels) {
+        const MeshLod& previous = lods.back();
+        size_t target = (size_t)(previous.mesh.triangleCount() * ratio);
+        if(target < minTriangles)
+            break;
+
+        float error = 0.0f;
+        MeshData simplified = simplifyMesh(previous.mesh, target, &error);
+        if(simplified.triangleCount() >= previous.mesh.triangleCount())
+            break;
+
+        // Errors add up along the chain
+        float totalError = previous.error + error;
+        lods.push_back(MeshLod{std::move(simplified), totalError});
+    }
+
+    return lods;
+}
+
+LodSelector::LodSelector(float threshold, float hysteresis):
+    _eye(0.0f),
+    _pixelsPerUnit(1.0f),
+    _threshold(threshold),
+    _hysteresis(hysteresis)
+{
+}
+
+void LodSelector::setView(const Camera& camera, int viewportHeight)
+{
+    _eye = camera.position();
+    _pixelsPerUnit = viewportHeight / (2.0f * std::tan(glm::radians(camera.zoom()) * 0.5f));
+}
+
+float LodSelector::projectedError(float error, const glm::vec3& center, float radius) const
+{
+    float distance = std::max(glm::length(center - _eye) - radius, Camera::DEFAULT_NEAR);
+    return error * _pixelsPerUnit / distance;
+}
+
+int LodSelector::select(const glm::vec3& center, float radius,
+                        const float* errors, int levelCount,
+                        int currentLevel) const
+{
+    int desired = 0;
+    for(int i = 0; i < levelCount; i++) {
+        if(projectedError(errors[i], center, radius) <= _threshold)
+            desired = i;
+    }
+
+    if(currentLevel < 0 || currentLevel >= levelCount)
+        return desired;
+
+    if(desired > currentLevel) {
+        // Coarser: only as far as the error stays clearly under the threshold
+        while(desired > currentLevel &&
+              projectedError(errors[desired], center, radius) > _threshold * (1.0f - _hysteresis))
+            desired--;
+    } else if(desired < currentLevel) {
+        // Finer: keep the current level while it is only slightly too coarse
+        if(projectedError(errors[currentLevel], center, radius) <= _threshold * (1.0f + _hysteresis))
+            desired = currentLevel;
+    }
+
+    return desired;
+}
+
+int LodSelector::select(const glm::vec3& center, float radius,
+                        const std::vector<MeshLod>& lods,
+                        int currentLevel) const
+{
+    float errors[MAX_LEVELS];
+    int count = std::min((int)lods.size(), (int)MAX_LEVELS);
+    for(int i = 0; i < count; i++)
+        errors[i] = lods[i].error;
+    return select(center, radius, errors, count, currentLevel);
+}
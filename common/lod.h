@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+
+class Camera;
+
+struct MeshLod {
+    MeshData mesh;
+    float error;    /* Geometric error relative to level 0, in mesh units */
+};
+
+/*
+ * Offline: build a chain of LODs, each level keeping `ratio` of the
+ * triangles of the previous one. Level 0 is the input mesh. Stops early
+ * when simplification can't make progress or minTriangles is reached.
+ */
+std::vector<MeshLod> buildLodChain(const MeshData& mesh,
+                                   int maxLevels = 5,
+                                   float ratio = 0.5f,
+                                   size_t minTriangles = 32);
+
+/*
+ * Runtime: pick the coarsest LOD whose geometric error projects to less
+ * than `threshold` pixels. To avoid popping back and forth around the
+ * switch distance, switching to a coarser level requires the error to be
+ * below threshold * (1 - hysteresis), and switching to a finer level
+ * requires the current error to exceed threshold * (1 + hysteresis).
+ */
+class LodSelector {
+    public:
+        static const int MAX_LEVELS = 16;
+
+    private:
+        glm::vec3 _eye;
+        float _pixelsPerUnit;       /* At distance 1 */
+        float _threshold;
+        float _hysteresis;
+
+    public:
+        LodSelector(float threshold = 1.0f, float hysteresis = 0.2f);
+
+        // Field of view from Camera::zoom(), height from context::windowHeight
+        void setView(const Camera& camera, int viewportHeight);
+
+        float projectedError(float error, const glm::vec3& center, float radius) const;
+
+        // errors[i] is the error of level i, currentLevel -1 if none yet
+        int select(const glm::vec3& center, float radius,
+                   const float* errors, int levelCount,
+                   int currentLevel = -1) const;
+        int select(const glm::vec3& center, float radius,
+                   const std::vector<MeshLod>& lods,
+                   int currentLevel = -1) const;
+};
@@ -0,0 +1,40 @@
+#include "mesh.h"
+
+#include <limits>
+#include <map>
+#include <tuple>
+
+size_t MeshData::triangleCount() const
+{
+    return indices.size() / 3;
+}
+
+AABB MeshData::bounds() const
+{
+    const float inf = std::numeric_limits<float>::infinity();
+    AABB box = { glm::vec3(inf), glm::vec3(-inf) };
+    for(const auto& p : positions) {
+        box.min = glm::min(box.min, p);
+        box.max = glm::max(box.max, p);
+    }
+    return box;
+}
+
+MeshData MeshData::fromTriangles(const float* vertices, size_t vertexCount, size_t stride)
+{
+    MeshData mesh;
+    std::map<std::tuple<float, float, float>, uint32_t> welded;
+
+    for(size_t i = 0; i < vertexCount; i++) {
+        const float* v = vertices + i * stride;
+        auto key = std::make_tuple(v[0], v[1], v[2]);
+        auto it = welded.find(key);
+        if(it == welded.end()) {
+            it = welded.insert(std::make_pair(key, (uint32_t)mesh.positions.size())).first;
+            mesh.positions.push_back(glm::vec3(v[0], v[1], v[2]));
+        }
+        mesh.indices.push_back(it->second);
+    }
+
+    return mesh;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+/*
+ * Indexed triangle mesh, positions only
+ */
+struct MeshData {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+
+    size_t triangleCount() const;
+    AABB bounds() const;
+
+    // Build from a non indexed triangle list (like the arrays in meshes.h),
+    // welding vertices with identical positions. Stride is in floats.
+    static MeshData fromTriangles(const float* vertices, size_t vertexCount, size_t stride);
+};
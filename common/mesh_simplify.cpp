@@ -0,0 +1,338 @@
+#include "mesh_simplify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <utility>
+
+namespace {
+
+// Symmetric 4x4 matrix, upper triangle
+struct Quadric {
+    double a[10];
+
+    Quadric()
+    {
+        std::fill(a, a + 10, 0.0);
+    }
+
+    static Quadric fromPlane(const glm::vec3& n, float d, double weight)
+    {
+        Quadric q;
+        q.a[0] = n.x * n.x; q.a[1] = n.x * n.y; q.a[2] = n.x * n.z; q.a[3] = n.x * d;
+        q.a[4] = n.y * n.y; q.a[5] = n.y * n.z; q.a[6] = n.y * d;
+        q.a[7] = n.z * n.z; q.a[8] = n.z * d;
+        q.a[9] = d * d;
+        for(double& v : q.a)
+            v *= weight;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& q)
+    {
+        for(int i = 0; i < 10; i++)
+            a[i] += q.a[i];
+        return *this;
+    }
+
+    double evaluate(const glm::vec3& v) const
+    {
+        double x = v.x, y = v.y, z = v.z;
+        return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x +
+               a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y +
+               a[7] * z * z + 2 * a[8] * z +
+               a[9];
+    }
+
+    // Position minimizing the error, false if the system is singular
+    bool optimal(glm::vec3& v) const
+    {
+        double det = a[0] * (a[4] * a[7] - a[5] * a[5]) -
+                     a[1] * (a[1] * a[7] - a[5] * a[2]) +
+                     a[2] * (a[1] * a[5] - a[4] * a[2]);
+        if(std::fabs(det) < 1e-12)
+            return false;
+
+        double bx = -a[3], by = -a[6], bz = -a[8];
+        double dx = bx * (a[4] * a[7] - a[5] * a[5]) -
+                    a[1] * (by * a[7] - a[5] * bz) +
+                    a[2] * (by * a[5] - a[4] * bz);
+        double dy = a[0] * (by * a[7] - bz * a[5]) -
+                    bx * (a[1] * a[7] - a[5] * a[2]) +
+                    a[2] * (a[1] * bz - by * a[2]);
+        double dz = a[0] * (a[4] * bz - a[5] * by) -
+                    a[1] * (a[1] * bz - by * a[2]) +
+                    bx * (a[1] * a[5] - a[4] * a[2]);
+        v = glm::vec3((float)(dx / det), (float)(dy / det), (float)(dz / det));
+        return true;
+    }
+};
+
+struct Collapse {
+    double cost;
+    uint32_t a, b;
+    uint32_t versionA, versionB;
+    glm::vec3 position;
+
+    bool operator>(const Collapse& other) const
+    {
+        return cost > other.cost;
+    }
+};
+
+class Simplifier {
+    private:
+        std::vector<glm::vec3> _positions;
+        std::vector<uint32_t> _indices;
+        std::vector<bool> _deadTris;
+        std::vector<bool> _deadVerts;
+        std::vector<uint32_t> _versions;
+        std::vector<Quadric> _quadrics;
+        std::vector<std::vector<uint32_t>> _vertTris;
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> _heap;
+        size_t _liveTris;
+
+    public:
+        Simplifier(const MeshData& mesh);
+        MeshData run(size_t targetTriangles, float* error);
+
+    private:
+        glm::vec3 triNormal(uint32_t tri, uint32_t replaced, const glm::vec3& position) const;
+        bool flips(uint32_t v, uint32_t other, const glm::vec3& position) const;
+        void pushCollapse(uint32_t a, uint32_t b);
+        void collapse(const Collapse& c);
+};
+
+Simplifier::Simplifier(const MeshData& mesh):
+    _positions(mesh.positions),
+    _indices(mesh.indices),
+    _deadTris(mesh.triangleCount(), false),
+    _deadVerts(mesh.positions.size(), false),
+    _versions(mesh.positions.size(), 0),
+    _quadrics(mesh.positions.size()),
+    _vertTris(mesh.positions.size()),
+    _liveTris(mesh.triangleCount())
+{
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    edges.reserve(_indices.size());
+
+    for(uint32_t t = 0; t < _deadTris.size(); t++) {
+        const uint32_t* v = &_indices[t * 3];
+        glm::vec3 n = glm::cross(_positions[v[1]] - _positions[v[0]],
+                                 _positions[v[2]] - _positions[v[0]]);
+        float len = glm::length(n);
+        if(len > 0.0f) {
+            n = n / len;
+            Quadric q = Quadric::fromPlane(n, -glm::dot(n, _positions[v[0]]), 1.0);
+            for(int k = 0; k < 3; k++)
+                _quadrics[v[k]] += q;
+        }
+
+        for(int k = 0; k < 3; k++) {
+            _vertTris[v[k]].push_back(t);
+            uint32_t a = v[k], b = v[(k + 1) % 3];
+            edges.push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+        }
+    }
+
+    // Edges used by a single triangle are borders: constrain them with a
+    // heavily weighted plane perpendicular to the face so they don't erode
+    std::sort(edges.begin(), edges.end());
+    for(size_t i = 0; i < edges.size();) {
+        size_t j = i + 1;
+        while(j < edges.size() && edges[j] == edges[i])
+            j++;
+
+        uint32_t a = edges[i].first, b = edges[i].second;
+        if(j - i == 1) {
+            for(uint32_t t : _vertTris[a]) {
+                const uint32_t* v = &_indices[t * 3];
+                if(v[0] != b && v[1] != b && v[2] != b)
+                    continue;
+
+                glm::vec3 faceNormal = glm::cross(_positions[v[1]] - _positions[v[0]],
+                                                  _positions[v[2]] - _positions[v[0]]);
+                glm::vec3 n = glm::cross(_positions[b] - _positions[a], faceNormal);
+                float len = glm::length(n);
+                if(len > 0.0f) {
+                    n = n / len;
+                    Quadric q = Quadric::fromPlane(n, -glm::dot(n, _positions[a]), 100.0);
+                    _quadrics[a] += q;
+                    _quadrics[b] += q;
+                }
+                break;
+            }
+        }
+
+        pushCollapse(a, b);
+        i = j;
+    }
+}
+
+void Simplifier::pushCollapse(uint32_t a, uint32_t b)
+{
+    Quadric q = _quadrics[a];
+    q += _quadrics[b];
+
+    Collapse c;
+    c.a = a;
+    c.b = b;
+    c.versionA = _versions[a];
+    c.versionB = _versions[b];
+
+    if(q.optimal(c.position)) {
+        c.cost = q.evaluate(c.position);
+    } else {
+        // Singular: pick the best of both ends and the midpoint
+        const glm::vec3 candidates[3] = {
+            _positions[a], _positions[b], (_positions[a] + _positions[b]) * 0.5f
+        };
+        c.cost = -1.0;
+        for(const auto& p : candidates) {
+            double cost = q.evaluate(p);
+            if(c.cost < 0.0 || cost < c.cost) {
+                c.cost = cost;
+                c.position = p;
+            }
+        }
+    }
+
+    c.cost = std::max(c.cost, 0.0);
+    _heap.push(c);
+}
+
+glm::vec3 Simplifier::triNormal(uint32_t tri, uint32_t replaced, const glm::vec3& position) const
+{
+    glm::vec3 p[3];
+    for(int k = 0; k < 3; k++) {
+        uint32_t v = _indices[tri * 3 + k];
+        p[k] = v == replaced ? position : _positions[v];
+    }
+    return glm::cross(p[1] - p[0], p[2] - p[0]);
+}
+
+bool Simplifier::flips(uint32_t v, uint32_t other, const glm::vec3& position) const
+{
+    for(uint32_t t : _vertTris[v]) {
+        if(_deadTris[t])
+            continue;
+
+        const uint32_t* idx = &_indices[t * 3];
+        if(idx[0] == other || idx[1] == other || idx[2] == other)
+            continue;   /* Removed by the collapse */
+
+        glm::vec3 before = triNormal(t, v, _positions[v]);
+        glm::vec3 after = triNormal(t, v, position);
+        float lenBefore = glm::length(before), lenAfter = glm::length(after);
+        if(lenAfter <= 1e-12f)
+            return true;
+        if(lenBefore > 0.0f && glm::dot(before, after) < 0.2f * lenBefore * lenAfter)
+            return true;
+    }
+    return false;
+}
+
+void Simplifier::collapse(const Collapse& c)
+{
+    const uint32_t a = c.a, b = c.b;
+
+    _positions[a] = c.position;
+    _quadrics[a] += _quadrics[b];
+    _deadVerts[b] = true;
+    _versions[a]++;
+    _versions[b]++;
+
+    // Move b's triangles to a, dropping the ones that degenerate
+    for(uint32_t t : _vertTris[b]) {
+        if(_deadTris[t])
+            continue;
+
+        uint32_t* idx = &_indices[t * 3];
+        bool hasA = idx[0] == a || idx[1] == a || idx[2] == a;
+        if(hasA) {
+            _deadTris[t] = true;
+            _liveTris--;
+            continue;
+        }
+
+        for(int k = 0; k < 3; k++) {
+            if(idx[k] == b)
+                idx[k] = a;
+        }
+        _vertTris[a].push_back(t);
+    }
+    _vertTris[b].clear();
+
+    // Compact a's triangle list and requeue the edges around it
+    auto& tris = _vertTris[a];
+    tris.erase(std::remove_if(tris.begin(), tris.end(),
+                              [this](uint32_t t) { return (bool)_deadTris[t]; }),
+               tris.end());
+
+    std::vector<uint32_t> neighbours;
+    for(uint32_t t : tris) {
+        for(int k = 0; k < 3; k++) {
+            uint32_t v = _indices[t * 3 + k];
+            if(v != a)
+                neighbours.push_back(v);
+        }
+    }
+    std::sort(neighbours.begin(), neighbours.end());
+    neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+    for(uint32_t n : neighbours)
+        pushCollapse(a, n);
+}
+
+MeshData Simplifier::run(size_t targetTriangles, float* error)
+{
+    double maxCost = 0.0;
+
+    while(_liveTris > targetTriangles && !_heap.empty()) {
+        Collapse c = _heap.top();
+        _heap.pop();
+
+        // Stale entry
+        if(_deadVerts[c.a] || _deadVerts[c.b] ||
+           _versions[c.a] != c.versionA || _versions[c.b] != c.versionB)
+            continue;
+
+        if(flips(c.a, c.b, c.position) || flips(c.b, c.a, c.position))
+            continue;
+
+        collapse(c);
+        maxCost = std::max(maxCost, c.cost);
+    }
+
+    // The quadric error is a sum of squared plane distances, its square
+    // root bounds the distance to any of the original planes
+    if(error)
+        *error = (float)std::sqrt(maxCost);
+
+    MeshData result;
+    std::vector<uint32_t> remap(_positions.size(), UINT32_MAX);
+    for(size_t t = 0; t < _deadTris.size(); t++) {
+        if(_deadTris[t])
+            continue;
+
+        for(int k = 0; k < 3; k++) {
+            uint32_t v = _indices[t * 3 + k];
+            if(remap[v] == UINT32_MAX) {
+                remap[v] = (uint32_t)result.positions.size();
+                result.positions.push_back(_positions[v]);
+            }
+            result.indices.push_back(remap[v]);
+        }
+    }
+
+    return result;
+}
+
+}
+
+MeshData simplifyMesh(const MeshData& mesh, size_t targetTriangles, float* error)
+{
+    Simplifier simplifier(mesh);
+    return simplifier.run(targetTriangles, error);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+
+#include "mesh.h"
+
+/*
+ * Quadric error metric edge collapse simplification (Garland & Heckbert).
+ * Stops when the triangle count reaches targetTriangles or when no more
+ * edges can be collapsed without flipping faces.
+ * If error is not null, it receives the largest geometric error
+ * introduced, in mesh units.
+ */
+MeshData simplifyMesh(const MeshData& mesh, size_t targetTriangles, float* error = nullptr);
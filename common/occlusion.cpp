@@ -0,0 +1,402 @@
+#include "occlusion.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define OCCLUSION_SSE 1
+#include <emmintrin.h>
+#endif
+
+OcclusionCuller::OcclusionCuller(int width, int height, int threadCount):
+    _width((width + 3) & ~3),   /* Rows are processed 4 pixels at a time */
+    _height(height),
+    _stats{},
+    _generation(0),
+    _pending(0),
+    _quit(false),
+    _nextTile(0)
+{
+    _tilesX = (_width + TILE_SIZE - 1) / TILE_SIZE;
+    _tilesY = (_height + TILE_SIZE - 1) / TILE_SIZE;
+    _bins.resize(_tilesX * _tilesY);
+
+    // Hi-Z pyramid down to 1x1
+    int w = _width, h = _height;
+    while(true) {
+        _levels.push_back(std::vector<float>(w * h, 1.0f));
+        _levelWidth.push_back(w);
+        _levelHeight.push_back(h);
+        if(w == 1 && h == 1)
+            break;
+        w = std::max(1, (w + 1) / 2);
+        h = std::max(1, (h + 1) / 2);
+    }
+
+    if(threadCount <= 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, _tilesX * _tilesY);
+
+    // The calling thread rasterizes too
+    for(int i = 1; i < threadCount; i++)
+        _workers.push_back(std::thread(&OcclusionCuller::workerLoop, this));
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
+    }
+    _wake.notify_all();
+
+    for(auto& worker : _workers)
+        worker.join();
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& viewProjection)
+{
+    _viewProjection = viewProjection;
+    _triangles.clear();
+    for(auto& bin : _bins)
+        bin.clear();
+    std::fill(_levels[0].begin(), _levels[0].end(), 1.0f);
+    _stats = {};
+}
+
+void OcclusionCuller::addOccluder(const float* vertices, size_t vertexCount, size_t stride,
+                                  const glm::mat4& model)
+{
+    glm::mat4 mvp = _viewProjection * model;
+    for(size_t i = 0; i + 2 < vertexCount; i += 3) {
+        const float* v0 = vertices + i * stride;
+        const float* v1 = v0 + stride;
+        const float* v2 = v1 + stride;
+        clipTriangle(mvp * glm::vec4(v0[0], v0[1], v0[2], 1.0f),
+                     mvp * glm::vec4(v1[0], v1[1], v1[2], 1.0f),
+                     mvp * glm::vec4(v2[0], v2[1], v2[2], 1.0f));
+    }
+}
+
+void OcclusionCuller::clipTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+    // Only the near plane (z >= -w) needs clipping, everything else is
+    // handled by clamping to the screen and depth range
+    const glm::vec4 in[3] = { a, b, c };
+    float dist[3];
+    int insideCount = 0;
+    for(int i = 0; i < 3; i++) {
+        dist[i] = in[i].z + in[i].w;
+        if(dist[i] >= 0.0f)
+            insideCount++;
+    }
+
+    if(insideCount == 3) {
+        setupTriangle(a, b, c);
+        return;
+    }
+    if(insideCount == 0)
+        return;
+
+    glm::vec4 out[4];
+    int outCount = 0;
+    for(int i = 0; i < 3; i++) {
+        int j = (i + 1) % 3;
+        if(dist[i] >= 0.0f)
+            out[outCount++] = in[i];
+        if((dist[i] >= 0.0f) != (dist[j] >= 0.0f)) {
+            float t = dist[i] / (dist[i] - dist[j]);
+            out[outCount++] = in[i] + (in[j] - in[i]) * t;
+        }
+    }
+
+    for(int i = 1; i + 1 < outCount; i++)
+        setupTriangle(out[0], out[i], out[i + 1]);
+}
+
+void OcclusionCuller::setupTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+    const glm::vec4* v[3] = { &a, &b, &c };
+    Triangle tri;
+    float z[3];
+    for(int i = 0; i < 3; i++) {
+        float invW = 1.0f / std::max(v[i]->w, 1e-6f);
+        tri.x[i] = (v[i]->x * invW * 0.5f + 0.5f) * _width;
+        tri.y[i] = (v[i]->y * invW * 0.5f + 0.5f) * _height;
+        z[i] = v[i]->z * invW * 0.5f + 0.5f;
+    }
+
+    // Counter clockwise is front facing, drop back faces and degenerates
+    float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) -
+                 (tri.x[2] - tri.x[0]) * (tri.y[1] - tri.y[0]);
+    if(!(area > 0.0f))
+        return;
+
+    float minX = std::min(tri.x[0], std::min(tri.x[1], tri.x[2]));
+    float maxX = std::max(tri.x[0], std::max(tri.x[1], tri.x[2]));
+    float minY = std::min(tri.y[0], std::min(tri.y[1], tri.y[2]));
+    float maxY = std::max(tri.y[0], std::max(tri.y[1], tri.y[2]));
+    if(maxX < 0.0f || maxY < 0.0f || minX >= _width || minY >= _height)
+        return;
+
+    tri.minX = std::max(0, (int)std::floor(minX));
+    tri.minY = std::max(0, (int)std::floor(minY));
+    tri.maxX = std::min(_width - 1, (int)std::ceil(maxX));
+    tri.maxY = std::min(_height - 1, (int)std::ceil(maxY));
+
+    tri.z0 = z[0];
+    tri.dzdx = ((z[1] - z[0]) * (tri.y[2] - tri.y[0]) - (z[2] - z[0]) * (tri.y[1] - tri.y[0])) / area;
+    tri.dzdy = ((tri.x[1] - tri.x[0]) * (z[2] - z[0]) - (tri.x[2] - tri.x[0]) * (z[1] - z[0])) / area;
+
+    uint32_t index = (uint32_t)_triangles.size();
+    _triangles.push_back(tri);
+    _stats.triangles++;
+
+    // Bin
+    int tx0 = tri.minX / TILE_SIZE, tx1 = tri.maxX / TILE_SIZE;
+    int ty0 = tri.minY / TILE_SIZE, ty1 = tri.maxY / TILE_SIZE;
+    for(int ty = ty0; ty <= ty1; ty++) {
+        for(int tx = tx0; tx <= tx1; tx++) {
+            _bins[ty * _tilesX + tx].push_back(index);
+            _stats.binnedTriangles++;
+        }
+    }
+}
+
+void OcclusionCuller::rasterize()
+{
+    _nextTile = 0;
+    if(_workers.empty()) {
+        rasterizeTiles();
+    } else {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pending = (int)_workers.size();
+            _generation++;
+        }
+        _wake.notify_all();
+
+        rasterizeTiles();
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _done.wait(lock, [this]() { return _pending == 0; });
+    }
+
+    buildHiZ();
+}
+
+void OcclusionCuller::workerLoop()
+{
+    unsigned seen = 0;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&]() { return _quit || _generation != seen; });
+            if(_quit)
+                return;
+            seen = _generation;
+        }
+
+        rasterizeTiles();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(--_pending == 0)
+            _done.notify_one();
+    }
+}
+
+void OcclusionCuller::rasterizeTiles()
+{
+    const int tileCount = _tilesX * _tilesY;
+    int tile;
+    while((tile = _nextTile.fetch_add(1)) < tileCount)
+        rasterizeTile(tile);
+}
+
+void OcclusionCuller::rasterizeTile(int tile)
+{
+    const int tileX0 = (tile % _tilesX) * TILE_SIZE;
+    const int tileY0 = (tile / _tilesX) * TILE_SIZE;
+    const int tileX1 = std::min(tileX0 + TILE_SIZE, _width) - 1;
+    const int tileY1 = std::min(tileY0 + TILE_SIZE, _height) - 1;
+    float* depth = _levels[0].data();
+
+    for(uint32_t index : _bins[tile]) {
+        const Triangle& tri = _triangles[index];
+
+        // Start on a multiple of 4 so each group of 4 stays inside a row
+        int minX = std::max(tri.minX, tileX0) & ~3;
+        int maxX = std::min(tri.maxX, tileX1);
+        int minY = std::max(tri.minY, tileY0);
+        int maxY = std::min(tri.maxY, tileY1);
+        if(minX > maxX || minY > maxY)
+            continue;
+
+        // Edge functions E(x, y) = A * x + B * y + C, positive inside
+        float ea[3], eb[3], ec[3];
+        for(int k = 0; k < 3; k++) {
+            int n = (k + 1) % 3;
+            ea[k] = -(tri.y[n] - tri.y[k]);
+            eb[k] = tri.x[n] - tri.x[k];
+            ec[k] = -(ea[k] * tri.x[k] + eb[k] * tri.y[k]);
+        }
+        float za = tri.dzdx;
+        float zb = tri.dzdy;
+        float zc = tri.z0 - tri.dzdx * tri.x[0] - tri.dzdy * tri.y[0];
+
+#ifdef OCCLUSION_SSE
+        const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 limitX = _mm_set1_ps(maxX + 0.5f);
+        const __m128 a0 = _mm_set1_ps(ea[0]), a1 = _mm_set1_ps(ea[1]), a2 = _mm_set1_ps(ea[2]);
+        const __m128 vza = _mm_set1_ps(za);
+
+        for(int y = minY; y <= maxY; y++) {
+            float fy = y + 0.5f;
+            __m128 r0 = _mm_set1_ps(eb[0] * fy + ec[0]);
+            __m128 r1 = _mm_set1_ps(eb[1] * fy + ec[1]);
+            __m128 r2 = _mm_set1_ps(eb[2] * fy + ec[2]);
+            __m128 rz = _mm_set1_ps(zb * fy + zc);
+            float* row = depth + y * _width;
+
+            for(int x = minX; x <= maxX; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), r0);
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), r1);
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), r2);
+
+                __m128 mask = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero),
+                                                    _mm_cmpge_ps(e1, zero)),
+                                         _mm_and_ps(_mm_cmpge_ps(e2, zero),
+                                                    _mm_cmple_ps(px, limitX)));
+                if(_mm_movemask_ps(mask) == 0)
+                    continue;
+
+                __m128 z = _mm_max_ps(zero, _mm_add_ps(_mm_mul_ps(vza, px), rz));
+                __m128 d = _mm_loadu_ps(row + x);
+                __m128 nd = _mm_min_ps(d, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(mask, nd), _mm_andnot_ps(mask, d)));
+            }
+        }
+#else
+        for(int y = minY; y <= maxY; y++) {
+            float fy = y + 0.5f;
+            float* row = depth + y * _width;
+            for(int x = minX; x <= maxX; x++) {
+                float fx = x + 0.5f;
+                if(ea[0] * fx + eb[0] * fy + ec[0] < 0.0f ||
+                   ea[1] * fx + eb[1] * fy + ec[1] < 0.0f ||
+                   ea[2] * fx + eb[2] * fy + ec[2] < 0.0f)
+                    continue;
+
+                float z = std::max(0.0f, za * fx + zb * fy + zc);
+                if(z < row[x])
+                    row[x] = z;
+            }
+        }
+#endif
+    }
+}
+
+void OcclusionCuller::buildHiZ()
+{
+    // Every texel keeps the farthest depth of the texels it covers
+    for(size_t level = 1; level < _levels.size(); level++) {
+        const std::vector<float>& src = _levels[level - 1];
+        std::vector<float>& dst = _levels[level];
+        int sw = _levelWidth[level - 1], sh = _levelHeight[level - 1];
+        int dw = _levelWidth[level], dh = _levelHeight[level];
+
+        for(int y = 0; y < dh; y++) {
+            int y0 = std::min(2 * y, sh - 1), y1 = std::min(2 * y + 1, sh - 1);
+            for(int x = 0; x < dw; x++) {
+                int x0 = std::min(2 * x, sw - 1), x1 = std::min(2 * x + 1, sw - 1);
+                dst[y * dw + x] = std::max(std::max(src[y0 * sw + x0], src[y0 * sw + x1]),
+                                           std::max(src[y1 * sw + x0], src[y1 * sw + x1]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::isOccluded(const AABB& box) const
+{
+    _stats.tested++;
+
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+    float minZ = 1.0f;
+    for(int i = 0; i < 8; i++) {
+        glm::vec4 corner((i & 1) ? box.max.x : box.min.x,
+                         (i & 2) ? box.max.y : box.min.y,
+                         (i & 4) ? box.max.z : box.min.z,
+                         1.0f);
+        glm::vec4 clip = _viewProjection * corner;
+
+        // Crossing the near plane, can't be proven hidden
+        if(clip.z < -clip.w || clip.w <= 1e-6f)
+            return false;
+
+        float invW = 1.0f / clip.w;
+        float sx = (clip.x * invW * 0.5f + 0.5f) * _width;
+        float sy = (clip.y * invW * 0.5f + 0.5f) * _height;
+        float sz = clip.z * invW * 0.5f + 0.5f;
+        minX = std::min(minX, sx); maxX = std::max(maxX, sx);
+        minY = std::min(minY, sy); maxY = std::max(maxY, sy);
+        minZ = std::min(minZ, sz);
+    }
+
+    // Off screen, that's the frustum culler's business
+    if(maxX < 0.0f || maxY < 0.0f || minX >= _width || minY >= _height)
+        return false;
+
+    int x0 = std::max(0, (int)std::floor(minX));
+    int y0 = std::max(0, (int)std::floor(minY));
+    int x1 = std::min(_width - 1, (int)std::floor(maxX));
+    int y1 = std::min(_height - 1, (int)std::floor(maxY));
+
+    // Pick the level where the rectangle spans at most 2 texels per axis
+    int level = 0;
+    int size = std::max(x1 - x0, y1 - y0) + 1;
+    while(size > 2 && level + 1 < (int)_levels.size()) {
+        size = (size + 1) / 2;
+        level++;
+    }
+
+    const std::vector<float>& hiz = _levels[level];
+    int lw = _levelWidth[level];
+    float maxDepth = 0.0f;
+    for(int y = y0 >> level; y <= (y1 >> level); y++) {
+        for(int x = x0 >> level; x <= (x1 >> level); x++)
+            maxDepth = std::max(maxDepth, hiz[y * lw + x]);
+    }
+
+    if(minZ > maxDepth) {
+        _stats.occluded++;
+        return true;
+    }
+    return false;
+}
+
+int OcclusionCuller::width() const
+{
+    return _width;
+}
+
+int OcclusionCuller::height() const
+{
+    return _height;
+}
+
+int OcclusionCuller::levelCount() const
+{
+    return (int)_levels.size();
+}
+
+const float* OcclusionCuller::depth(int level) const
+{
+    return _levels[level].data();
+}
+
+const OcclusionCuller::Stats& OcclusionCuller::stats() const
+{
+    return _stats;
+}
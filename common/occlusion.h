@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+/*
+ * CPU occlusion culling.
+ *
+ * Occluder triangles are transformed, binned into screen tiles and
+ * rasterized into a low resolution depth buffer (4 pixels at a time with
+ * SSE2, tiles spread over worker threads). A hierarchical-Z pyramid
+ * holding the farthest depth of each region is then built, against which
+ * object bounds are tested.
+ *
+ * Usage, once per frame:
+ *   beginFrame(viewProjection);
+ *   addOccluder(...);       // as many as needed
+ *   rasterize();
+ *   isOccluded(box);        // for every object to test
+ */
+class OcclusionCuller {
+    public:
+        static const int TILE_SIZE = 32;
+
+        struct Stats {
+            unsigned triangles;         /* Triangles after near clipping and backface culling */
+            unsigned binnedTriangles;   /* Sum of triangles over all tile bins */
+            unsigned tested;
+            unsigned occluded;
+        };
+
+    private:
+        struct Triangle {
+            float x[3], y[3];
+            float z0, dzdx, dzdy;       /* Depth plane, relative to vertex 0 */
+            int minX, minY, maxX, maxY;
+        };
+
+        int _width, _height;
+        int _tilesX, _tilesY;
+        glm::mat4 _viewProjection;
+
+        std::vector<Triangle> _triangles;
+        std::vector<std::vector<uint32_t>> _bins;
+        std::vector<std::vector<float>> _levels;    /* Level 0 is the depth buffer */
+        std::vector<int> _levelWidth, _levelHeight;
+        mutable Stats _stats;
+
+        // Worker threads
+        std::vector<std::thread> _workers;
+        std::mutex _mutex;
+        std::condition_variable _wake, _done;
+        unsigned _generation;
+        int _pending;
+        bool _quit;
+        std::atomic<int> _nextTile;
+
+    public:
+        // threadCount 0 uses every hardware thread (the caller included)
+        OcclusionCuller(int width = 256, int height = 128, int threadCount = 0);
+        ~OcclusionCuller();
+
+        OcclusionCuller(const OcclusionCuller&) = delete;
+        OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+        void beginFrame(const glm::mat4& viewProjection);
+
+        // Non indexed triangle list, stride in floats, position first
+        void addOccluder(const float* vertices, size_t vertexCount, size_t stride,
+                         const glm::mat4& model);
+
+        void rasterize();
+
+        // True only when the box is proven hidden behind occluders
+        bool isOccluded(const AABB& box) const;
+
+        int width() const;
+        int height() const;
+        int levelCount() const;
+        const float* depth(int level = 0) const;
+        const Stats& stats() const;
+
+    private:
+        void clipTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+        void setupTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+        void rasterizeTiles();
+        void rasterizeTile(int tile);
+        void buildHiZ();
+        void workerLoop();
+};
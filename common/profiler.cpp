@@ -0,0 +1,238 @@
+#include "profiler.h"
+#include "exception.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fmt/format.h>
+#include <fmt/printf.h>
+
+Profiler::Profiler():
+    _epoch(std::chrono::steady_clock::now()),
+    _frameIndex(0),
+    _inFrame(false),
+    _enabled(false),
+    _dropped(0),
+    _historyNext(0)
+{
+    for(auto& pending : _frames) {
+        pending.usedQueries = 0;
+        pending.cpuSync = 0.0;
+        pending.gpuSync = 0;
+        pending.pending = false;
+    }
+    _latest.index = 0;
+}
+
+Profiler::~Profiler()
+{
+    // Queries are left to the context, which is usually gone by now
+}
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::setEnabled(bool enabled)
+{
+    _enabled = enabled;
+}
+
+bool Profiler::enabled() const
+{
+    return _enabled;
+}
+
+double Profiler::now() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _epoch).count();
+}
+
+// Set nodes never move, so the pointer stays valid after later inserts
+const char* Profiler::intern(const char* name)
+{
+    return _names.insert(name).first->c_str();
+}
+
+void Profiler::beginFrame()
+{
+    if(!_enabled)
+        return;
+
+    PendingFrame& pending = _frames[_frameIndex % LATENCY];
+    if(pending.pending) {
+        GLint available = GL_TRUE;
+        if(pending.usedQueries)
+            glGetQueryObjectiv(pending.queries[pending.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if(available)
+            resolve(pending);
+        else
+            _dropped++;
+        pending.pending = false;
+    }
+
+    pending.frame.index = _frameIndex;
+    pending.frame.scopes.clear();
+    pending.queryScopes.clear();
+    pending.usedQueries = 0;
+    pending.cpuSync = now();
+    glGetInteger64v(GL_TIMESTAMP, &pending.gpuSync);
+
+    _stack.clear();
+    _inFrame = true;
+}
+
+void Profiler::endFrame()
+{
+    if(!_inFrame)
+        return;
+
+    assert(_stack.empty());
+    _frames[_frameIndex % LATENCY].pending = true;
+    _frameIndex++;
+    _inFrame = false;
+}
+
+int Profiler::beginScope(const char* name, bool gpu)
+{
+    if(!_enabled || !_inFrame)
+        return -1;
+
+    PendingFrame& pending = _frames[_frameIndex % LATENCY];
+    int index = (int)pending.frame.scopes.size();
+
+    profile_scope scope;
+    scope.name = intern(name);
+    scope.parent = _stack.empty() ? -1 : _stack.back();
+    scope.depth = (int)_stack.size();
+    scope.gpuStart = -1.0;
+    scope.gpuEnd = -1.0;
+
+    if(gpu) {
+        if(pending.queries.size() < pending.usedQueries + 2) {
+            size_t oldSize = pending.queries.size();
+            pending.queries.resize(std::max<size_t>(16, oldSize * 2));
+            glGenQueries((GLsizei)(pending.queries.size() - oldSize), &pending.queries[oldSize]);
+        }
+        pending.queryScopes.push_back((int)pending.usedQueries);
+        glQueryCounter(pending.queries[pending.usedQueries], GL_TIMESTAMP);
+        pending.usedQueries += 2;
+    } else {
+        pending.queryScopes.push_back(-1);
+    }
+
+    scope.cpuStart = now();
+    scope.cpuEnd = scope.cpuStart;
+    pending.frame.scopes.push_back(scope);
+    _stack.push_back(index);
+    return index;
+}
+
+void Profiler::endScope(int index)
+{
+    if(index < 0 || !_inFrame)
+        return;
+
+    PendingFrame& pending = _frames[_frameIndex % LATENCY];
+    pending.frame.scopes[index].cpuEnd = now();
+
+    int query = pending.queryScopes[index];
+    if(query >= 0)
+        glQueryCounter(pending.queries[query + 1], GL_TIMESTAMP);
+
+    assert(!_stack.empty() && _stack.back() == index);
+    _stack.pop_back();
+}
+
+void Profiler::resolve(PendingFrame& pending)
+{
+    for(size_t i = 0; i < pending.frame.scopes.size(); i++) {
+        int query = pending.queryScopes[i];
+        if(query < 0)
+            continue;
+
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(pending.queries[query], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(pending.queries[query + 1], GL_QUERY_RESULT, &end);
+
+        profile_scope& scope = pending.frame.scopes[i];
+        scope.gpuStart = pending.cpuSync + ((GLint64)start - pending.gpuSync) / 1e6;
+        scope.gpuEnd = pending.cpuSync + ((GLint64)end - pending.gpuSync) / 1e6;
+    }
+
+    _latest = pending.frame;
+    if(_history.size() < HISTORY) {
+        _history.push_back(pending.frame);
+    } else {
+        _history[_historyNext] = pending.frame;
+        _historyNext = (_historyNext + 1) % HISTORY;
+    }
+}
+
+const profile_frame& Profiler::latest() const
+{
+    return _latest;
+}
+
+unsigned Profiler::droppedFrames() const
+{
+    return _dropped;
+}
+
+std::string Profiler::report() const
+{
+    std::string result = fmt::format("frame {}\n", _latest.index);
+    for(const auto& scope : _latest.scopes) {
+        std::string line = fmt::format("{:{}}{}", "", scope.depth * 2, scope.name);
+        line = fmt::format("{:<32} cpu {:8.3f} ms", line, scope.cpuEnd - scope.cpuStart);
+        if(scope.gpuStart >= 0.0)
+            line += fmt::format("  gpu {:8.3f} ms", scope.gpuEnd - scope.gpuStart);
+        result += line + "\n";
+    }
+    return result;
+}
+
+void Profiler::writeChromeTrace(const std::string& filename) const
+{
+    FILE* f = fopen(filename.c_str(), "w");
+    if(!f)
+        throw Exception(fmt::format("Cannot write trace \"{}\"", filename));
+
+    fmt::fprintf(f, "{\"traceEvents\": [\n");
+    fmt::fprintf(f, "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"CPU\"}},\n");
+    fmt::fprintf(f, "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2, \"args\": {\"name\": \"GPU\"}}");
+
+    size_t start = _history.size() < HISTORY ? 0 : _historyNext;
+    for(size_t n = 0; n < _history.size(); n++) {
+        const profile_frame& frame = _history[(start + n) % _history.size()];
+        for(const auto& scope : frame.scopes) {
+            fmt::fprintf(f, ",\n  {\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, "
+                            "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"frame\": %d}}",
+                         scope.name, scope.cpuStart * 1000.0, (scope.cpuEnd - scope.cpuStart) * 1000.0,
+                         (int)frame.index);
+            if(scope.gpuStart >= 0.0) {
+                fmt::fprintf(f, ",\n  {\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": 2, "
+                                "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"frame\": %d}}",
+                             scope.name, scope.gpuStart * 1000.0, (scope.gpuEnd - scope.gpuStart) * 1000.0,
+                             (int)frame.index);
+            }
+        }
+    }
+
+    fmt::fprintf(f, "\n]}\n");
+    fclose(f);
+}
+
+void Profiler::release()
+{
+    for(auto& pending : _frames) {
+        if(!pending.queries.empty())
+            glDeleteQueries((GLsizei)pending.queries.size(), pending.queries.data());
+        pending.queries.clear();
+        pending.usedQueries = 0;
+        pending.pending = false;
+    }
+    _inFrame = false;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <glad/glad.h>
+
+struct profile_scope {
+    const char* name;           /* Interned, valid as long as the profiler */
+    int parent;                 /* Index in the same frame, -1 for roots */
+    int depth;
+    double cpuStart, cpuEnd;    /* Milliseconds since the profiler was created */
+    double gpuStart, gpuEnd;    /* Same timeline as cpu, negative for CPU-only scopes */
+};
+
+struct profile_frame {
+    uint64_t index;
+    std::vector<profile_scope> scopes;
+};
+
+/*
+ * Hierarchical frame profiler.
+ *
+ * CPU scopes are timed with steady_clock. GPU scopes additionally put a
+ * GL_TIMESTAMP query at each end. Queries come from a pool per frame in
+ * flight and are only read back LATENCY frames later, once available, so
+ * the profiler never waits on the GPU; frames whose queries still aren't
+ * done by then are dropped. GPU timestamps are mapped onto the CPU
+ * timeline with a GL_TIMESTAMP reading taken at beginFrame().
+ *
+ * Scope names are copied into a pool owned by the profiler, so they may
+ * come from a library that gets unloaded while its scopes are in the
+ * history.
+ *
+ * Scopes are recorded from the thread owning the GL context only.
+ * Use the PROFILE_CPU/PROFILE_GPU macros between beginFrame() and
+ * endFrame().
+ */
+class Profiler {
+    public:
+        static const int LATENCY = 4;
+        static const size_t HISTORY = 600;      /* Frames kept for the trace */
+
+    private:
+        struct PendingFrame {
+            profile_frame frame;
+            std::vector<GLuint> queries;        /* Pool, two per GPU scope */
+            std::vector<int> queryScopes;       /* First query index per scope, -1 for CPU */
+            size_t usedQueries;
+            double cpuSync;
+            GLint64 gpuSync;
+            bool pending;
+        };
+
+        std::chrono::steady_clock::time_point _epoch;
+        PendingFrame _frames[LATENCY];
+        std::vector<int> _stack;
+        uint64_t _frameIndex;
+        bool _inFrame;
+        bool _enabled;
+        unsigned _dropped;
+
+        std::unordered_set<std::string> _names;
+        std::vector<profile_frame> _history;    /* Ring of resolved frames */
+        size_t _historyNext;
+        profile_frame _latest;
+
+    public:
+        Profiler();
+        ~Profiler();
+
+        Profiler(const Profiler&) = delete;
+        Profiler& operator=(const Profiler&) = delete;
+
+        static Profiler& instance();
+
+        void setEnabled(bool enabled);
+        bool enabled() const;
+
+        void beginFrame();
+        void endFrame();
+
+        int beginScope(const char* name, bool gpu);
+        void endScope(int scope);
+
+        // Most recent frame with all its GPU results in
+        const profile_frame& latest() const;
+        unsigned droppedFrames() const;
+
+        // Text dump of latest() as an indented tree
+        std::string report() const;
+
+        // Resolved frames still in the history, in Chrome trace event
+        // format (chrome://tracing, ui.perfetto.dev)
+        void writeChromeTrace(const std::string& filename) const;
+
+        // Release the GL queries, needs the context to be current
+        void release();
+
+    private:
+        double now() const;
+        const char* intern(const char* name);
+        void resolve(PendingFrame& pending);
+};
+
+class ProfileScope {
+    private:
+        int _scope;
+
+    public:
+        ProfileScope(const char* name, bool gpu):
+            _scope(Profiler::instance().beginScope(name, gpu))
+        {
+        }
+
+        ~ProfileScope()
+        {
+            Profiler::instance().endScope(_scope);
+        }
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_CPU(name) ProfileScope PROFILE_CONCAT(profileScope_, __COUNTER__)(name, false)
+#define PROFILE_GPU(name) ProfileScope PROFILE_CONCAT(profileScope_, __COUNTER__)(name, true)
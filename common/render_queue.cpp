@@ -0,0 +1,168 @@
+#include "render_queue.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+
+RenderQueue::RenderQueue():
+    _programGeneration(Shader::programGeneration()),
+    _stats{}
+{
+}
+
+uint64_t RenderQueue::makeKey(unsigned layer, unsigned program, unsigned vao,
+                              unsigned material, float depth)
+{
+    uint64_t d = (uint64_t)(std::min(std::max(depth, 0.0f), 1.0f) * 0xfffff);
+    return ((uint64_t)(layer & 0xf) << 60) |
+           ((uint64_t)(program & 0xfff) << 48) |
+           ((uint64_t)(vao & 0xfff) << 36) |
+           ((uint64_t)(material & 0xffff) << 20) |
+           d;
+}
+
+void RenderQueue::clear()
+{
+    _packets.clear();
+    _items.clear();
+    _stats = {};
+}
+
+void RenderQueue::reserve(size_t count)
+{
+    _packets.reserve(count);
+    _items.reserve(count);
+    _scratch.reserve(count);
+}
+
+void RenderQueue::submit(const DrawPacket& packet)
+{
+    _items.push_back(SortItem{packet.key, (uint32_t)_packets.size()});
+    _packets.push_back(packet);
+}
+
+void RenderQueue::sort()
+{
+    // LSD radix sort, one byte per pass. Passes where every key has the
+    // same byte are skipped, which is most of them for small queues.
+    const size_t n = _items.size();
+    _scratch.resize(n);
+
+    for(int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = {};
+        for(const auto& item : _items)
+            histogram[(item.key >> shift) & 0xff]++;
+
+        if(histogram[(_items.empty() ? 0 : (_items[0].key >> shift) & 0xff)] == n)
+            continue;
+
+        size_t offset = 0;
+        for(int i = 0; i < 256; i++) {
+            size_t count = histogram[i];
+            histogram[i] = offset;
+            offset += count;
+        }
+
+        for(const auto& item : _items)
+            _scratch[histogram[(item.key >> shift) & 0xff]++] = item;
+        _items.swap(_scratch);
+    }
+}
+
+int RenderQueue::modelLocation(unsigned program)
+{
+    auto it = _modelLocations.find(program);
+    if(it == _modelLocations.end())
+        it = _modelLocations.insert(std::make_pair(program, glGetUniformLocation(program, "model"))).first;
+    return it->second;
+}
+
+void RenderQueue::execute()
+{
+    // Program names get reused once deleted, e.g. by a shader reload
+    if(_programGeneration != Shader::programGeneration()) {
+        _modelLocations.clear();
+        _programGeneration = Shader::programGeneration();
+    }
+
+    // Nothing is assumed about the current GL state
+    unsigned program = ~0u;
+    unsigned vao = ~0u;
+    unsigned textures[DrawPacket::MAX_TEXTURES];
+    std::fill(textures, textures + DrawPacket::MAX_TEXTURES, ~0u);
+    const void* material = nullptr;
+    bool materialValid = false;
+    int location = -1;
+
+    _stats.packets = (unsigned)_items.size();
+
+    for(const auto& item : _items) {
+        const DrawPacket& p = _packets[item.index];
+
+        if(p.program != program) {
+            glUseProgram(p.program);
+            program = p.program;
+            location = modelLocation(program);
+            materialValid = false;      /* Uniforms are per program */
+            _stats.programBinds++;
+        } else {
+            _stats.programBindsAvoided++;
+        }
+
+        if(p.vao != vao) {
+            glBindVertexArray(p.vao);
+            vao = p.vao;
+            _stats.vaoBinds++;
+        } else {
+            _stats.vaoBindsAvoided++;
+        }
+
+        for(int i = 0; i < DrawPacket::MAX_TEXTURES; i++) {
+            if(!p.textures[i])
+                continue;
+
+            if(p.textures[i] != textures[i]) {
+                glActiveTexture(GL_TEXTURE0 + i);
+                glBindTexture(GL_TEXTURE_2D, p.textures[i]);
+                textures[i] = p.textures[i];
+                _stats.textureBinds++;
+            } else {
+                _stats.textureBindsAvoided++;
+            }
+        }
+
+        if(p.applyMaterial) {
+            if(!materialValid || p.material != material) {
+                p.applyMaterial(program, p.material);
+                material = p.material;
+                materialValid = true;
+                _stats.materialBinds++;
+            } else {
+                _stats.materialBindsAvoided++;
+            }
+        }
+
+        if(location != -1) {
+            glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(p.model));
+            _stats.uniformUpdates++;
+        }
+
+        glDrawArrays(p.mode, p.first, p.count);
+        _stats.drawCalls++;
+    }
+}
+
+size_t RenderQueue::size() const
+{
+    return _items.size();
+}
+
+const DrawPacket& RenderQueue::packet(size_t sortedIndex) const
+{
+    return _packets[_items[sortedIndex].index];
+}
+
+const RenderQueueStats& RenderQueue::stats() const
+{
+    return _stats;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Uploads material uniforms for the given program
+typedef void (*MaterialProc)(unsigned program, const void* material);
+
+struct DrawPacket {
+    static const int MAX_TEXTURES = 4;
+
+    uint64_t key;
+    unsigned program;
+    unsigned vao;
+    unsigned textures[MAX_TEXTURES];    /* GL_TEXTURE_2D on unit i, 0 if unused */
+    const void* material;
+    MaterialProc applyMaterial;
+    glm::mat4 model;                    /* Uploaded to the "model" uniform */
+    GLenum mode;
+    int first;
+    int count;
+};
+
+struct RenderQueueStats {
+    unsigned packets;
+    unsigned drawCalls;
+    unsigned programBinds, programBindsAvoided;
+    unsigned vaoBinds, vaoBindsAvoided;
+    unsigned textureBinds, textureBindsAvoided;
+    unsigned materialBinds, materialBindsAvoided;
+    unsigned uniformUpdates;            /* Model matrix uploads */
+};
+
+/*
+ * Draw packets collected during the frame, radix sorted by their 64-bit
+ * key and executed skipping redundant program/VAO/texture/material binds.
+ *
+ * Key layout built by makeKey(), most significant first:
+ *   layer:4 | program:12 | vao:12 | material:16 | depth:20
+ * so packets get grouped by program, then VAO, then material and are
+ * drawn front to back within a group.
+ */
+class RenderQueue {
+    private:
+        struct SortItem {
+            uint64_t key;
+            uint32_t index;
+        };
+
+        std::vector<DrawPacket> _packets;
+        std::vector<SortItem> _items;
+        std::vector<SortItem> _scratch;
+        std::unordered_map<unsigned, int> _modelLocations;   /* Kept across frames */
+        unsigned _programGeneration;                        /* Shader::programGeneration() of the cache */
+        RenderQueueStats _stats;
+
+    public:
+        RenderQueue();
+
+        static uint64_t makeKey(unsigned layer, unsigned program, unsigned vao,
+                                unsigned material, float depth);
+
+        void clear();
+        void reserve(size_t count);
+        void submit(const DrawPacket& packet);
+        void sort();
+        void execute();
+
+        size_t size() const;
+        const DrawPacket& packet(size_t sortedIndex) const;
+        const RenderQueueStats& stats() const;
+
+    private:
+        int modelLocation(unsigned program);
+};
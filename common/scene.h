@@ -1,14 +1,47 @@
 #pragma once
 
 struct context;
+struct frame_input;
+class StateWriter;
+class StateReader;
 
 struct scene {
     void (*init)(context*);
     void (*release)(context*);
-    void (*draw)(float, context*);
+    void (*draw)(float, context*);      /* Unless build and submit are given */
+    void (*prepare)(const context*);    /* Optional, CPU-only loading run on a worker thread before init */
+
+    /*
+     * Optional reload handoff, see StateWriter. save_state is called on the
+     * outgoing scene before its release, restore_state on the incoming one
+     * before its init, which then only creates what wasn't adopted.
+     */
+    void (*save_state)(context*, StateWriter*);
+    void (*restore_state)(context*, StateReader*);
+
+    /*
+     * Optional, advances the simulation by a fixed dt in seconds. Called
+     * zero or more times per frame before draw, which interpolates with
+     * context::alpha.
+     */
+    void (*update)(float, context*);
+
+    /*
+     * Optional, draw split in two so the host can overlap them. build()
+     * does the CPU side of a frame (transforms, culling, sorting) into one
+     * of SCENE_FRAME_SLOTS slots, possibly on a worker thread: no GL, no
+     * Profiler, and only reading scene state that update() writes. submit()
+     * then issues a built slot on the render thread. The host never builds
+     * and updates at the same time, nor builds the slot being submitted.
+     */
+    void (*build)(const frame_input*, int);
+    void (*submit)(context*, int);
 };
 
 typedef void (*GETSCENEPROC)(scene*);
 
+// Frames a scene builds ahead for build/submit, see scene
+static const int SCENE_FRAME_SLOTS = 2;
+
 
 
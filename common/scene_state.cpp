@@ -0,0 +1,199 @@
+#include "scene_state.h"
+#include "exception.h"
+#include "shader.h"
+
+#include <fmt/format.h>
+#include <glad/glad.h>
+
+static const char STATE_MAGIC[4] = { 'G', 'S', 'T', 'A' };
+
+struct state_header {
+    char magic[4];
+    uint32_t version;
+    uint32_t resourceCount;
+    uint32_t dataSize;
+};
+
+struct state_resource {
+    uint32_t type;
+    uint32_t id;
+    uint64_t key;
+    uint32_t nameLength;        /* Name bytes follow */
+};
+
+uint64_t state_hash(const void* data, size_t size, uint64_t seed)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    for(size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t state_hash(const std::string& s, uint64_t seed)
+{
+    return state_hash(s.data(), s.size(), seed);
+}
+
+StateWriter::StateWriter():
+    _version(0)
+{
+}
+
+void StateWriter::setVersion(uint32_t version)
+{
+    _version = version;
+}
+
+void StateWriter::addResource(const std::string& name, scene_resource_type type, uint32_t id, uint64_t key)
+{
+    if(id)
+        _resources.push_back(scene_resource{ name, (uint32_t)type, id, key });
+}
+
+void StateWriter::write(const void* data, size_t size)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    _data.insert(_data.end(), p, p + size);
+}
+
+void StateWriter::writeString(const std::string& s)
+{
+    write((uint32_t)s.size());
+    write(s.data(), s.size());
+}
+
+std::vector<unsigned char> StateWriter::finish() const
+{
+    std::vector<unsigned char> blob;
+    auto append = [&blob](const void* data, size_t size) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        blob.insert(blob.end(), p, p + size);
+    };
+
+    state_header header;
+    memcpy(header.magic, STATE_MAGIC, sizeof(STATE_MAGIC));
+    header.version = _version;
+    header.resourceCount = (uint32_t)_resources.size();
+    header.dataSize = (uint32_t)_data.size();
+    append(&header, sizeof(header));
+
+    for(const auto& resource : _resources) {
+        state_resource record = { resource.type, resource.id, resource.key, (uint32_t)resource.name.size() };
+        append(&record, sizeof(record));
+        append(resource.name.data(), resource.name.size());
+    }
+    append(_data.data(), _data.size());
+    return blob;
+}
+
+StateReader::StateReader(const std::vector<unsigned char>& blob):
+    _offset(0)
+{
+    size_t offset = 0;
+    auto take = [&blob, &offset](void* data, size_t size) {
+        if(blob.size() - offset < size)
+            throw Exception("Truncated scene state");
+        memcpy(data, blob.data() + offset, size);
+        offset += size;
+    };
+
+    state_header header;
+    take(&header, sizeof(header));
+    if(memcmp(header.magic, STATE_MAGIC, sizeof(STATE_MAGIC)) != 0)
+        throw Exception("Invalid scene state");
+    _version = header.version;
+
+    _resources.reserve(header.resourceCount);
+    for(uint32_t i = 0; i < header.resourceCount; i++) {
+        state_resource record;
+        take(&record, sizeof(record));
+        std::string name(record.nameLength, '\0');
+        take(&name[0], record.nameLength);
+        _index[name] = _resources.size();
+        _resources.push_back(scene_resource{ name, record.type, record.id, record.key });
+    }
+    _states.assign(_resources.size(), OPEN);
+
+    _data.resize(header.dataSize);
+    take(_data.data(), _data.size());
+}
+
+uint32_t StateReader::version() const
+{
+    return _version;
+}
+
+uint32_t StateReader::adopt(const std::string& name, scene_resource_type type, uint64_t key)
+{
+    auto it = _index.find(name);
+    if(it == _index.end())
+        return 0;
+
+    size_t i = it->second;
+    const scene_resource& resource = _resources[i];
+    if(_states[i] != OPEN || resource.type != (uint32_t)type || resource.key != key)
+        return 0;
+    _states[i] = ADOPTED;
+    return resource.id;
+}
+
+void StateReader::read(void* data, size_t size)
+{
+    if(_data.size() - _offset < size)
+        throw Exception(fmt::format("Scene state read past the end ({} bytes at {} of {})",
+                                    size, _offset, _data.size()));
+    memcpy(data, _data.data() + _offset, size);
+    _offset += size;
+}
+
+std::string StateReader::readString()
+{
+    uint32_t size = read<uint32_t>();
+    std::string s(size, '\0');
+    read(&s[0], size);
+    return s;
+}
+
+size_t StateReader::releaseUnclaimed()
+{
+    size_t count = 0;
+    for(size_t i = 0; i < _resources.size(); i++) {
+        if(_states[i] != OPEN)
+            continue;
+
+        GLuint id = _resources[i].id;
+        switch(_resources[i].type) {
+            case RESOURCE_BUFFER:
+                glDeleteBuffers(1, &id);
+                break;
+            case RESOURCE_VERTEX_ARRAY:
+                glDeleteVertexArrays(1, &id);
+                break;
+            case RESOURCE_TEXTURE:
+                glDeleteTextures(1, &id);
+                break;
+            case RESOURCE_PROGRAM:
+                Shader::deleteProgram(id);
+                break;
+        }
+        _states[i] = RELEASED;
+        count++;
+    }
+    return count;
+}
+
+size_t StateReader::resourceCount() const
+{
+    return _resources.size();
+}
+
+size_t StateReader::adoptedCount() const
+{
+    size_t count = 0;
+    for(ResourceState state : _states)
+        count += state == ADOPTED;
+    return count;
+}
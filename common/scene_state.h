@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum scene_resource_type {
+    RESOURCE_BUFFER = 1,
+    RESOURCE_VERTEX_ARRAY,
+    RESOURCE_TEXTURE,
+    RESOURCE_PROGRAM
+};
+
+struct scene_resource {
+    std::string name;
+    uint32_t type;              /* scene_resource_type */
+    uint32_t id;                /* GL name */
+    uint64_t key;               /* Hash of what the resource was built from */
+};
+
+// 64-bit FNV-1a, chain calls through seed
+static const uint64_t STATE_HASH_SEED = 14695981039346656037ull;
+uint64_t state_hash(const void* data, size_t size, uint64_t seed = STATE_HASH_SEED);
+uint64_t state_hash(const std::string& s, uint64_t seed = STATE_HASH_SEED);
+
+/*
+ * Scene state handed from a library being unloaded to its replacement.
+ *
+ * The blob starts with a header carrying the format version chosen by the
+ * scene, followed by a table of GL resources and the scene's own data.
+ * Resources added to the writer change owner: the saving scene must no
+ * longer delete them. The restoring scene adopts those whose name, type
+ * and key still match what it would build; the loader deletes the rest.
+ */
+class StateWriter {
+    private:
+        uint32_t _version;
+        std::vector<scene_resource> _resources;
+        std::vector<unsigned char> _data;
+
+    public:
+        StateWriter();
+
+        // Format version of the scene's data, checked by the restoring side
+        void setVersion(uint32_t version);
+
+        void addResource(const std::string& name, scene_resource_type type, uint32_t id, uint64_t key);
+
+        void write(const void* data, size_t size);
+        void writeString(const std::string& s);
+
+        template<typename T>
+        void write(const T& value)
+        {
+            write(&value, sizeof(value));
+        }
+
+        std::vector<unsigned char> finish() const;
+};
+
+class StateReader {
+    private:
+        uint32_t _version;
+        enum ResourceState { OPEN, ADOPTED, RELEASED };
+
+        std::vector<scene_resource> _resources;
+        std::vector<ResourceState> _states;
+        std::unordered_map<std::string, size_t> _index;    /* Name to resource */
+        std::vector<unsigned char> _data;
+        size_t _offset;
+
+    public:
+        // Throws on a malformed blob
+        explicit StateReader(const std::vector<unsigned char>& blob);
+
+        uint32_t version() const;
+
+        // GL name of a matching resource, 0 when there is none
+        uint32_t adopt(const std::string& name, scene_resource_type type, uint64_t key);
+
+        void read(void* data, size_t size);
+        std::string readString();
+
+        template<typename T>
+        T read()
+        {
+            T value;
+            read(&value, sizeof(value));
+            return value;
+        }
+
+        // Deletes the resources nobody adopted, returns how many
+        size_t releaseUnclaimed();
+        size_t resourceCount() const;
+        size_t adoptedCount() const;
+};
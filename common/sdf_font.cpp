@@ -0,0 +1,273 @@
+#include "sdf_font.h"
+#include "exception.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <fmt/format.h>
+#include <fmt/printf.h>
+
+#include "stb_truetype.h"
+
+static const char CACHE_MAGIC[4] = { 'G', 'S', 'D', 'F' };
+static const uint32_t CACHE_VERSION = 1;
+
+struct sdf_cache_header {
+    char magic[4];
+    uint32_t version;
+    uint32_t fontHash;
+    uint32_t baseSize, padding, onEdge;
+    uint32_t firstChar, charCount;
+    uint32_t width, height;
+};
+
+SdfFont::SdfFont(const std::vector<unsigned char>& font,
+                 const std::string& cacheFile,
+                 int firstChar, int charCount,
+                 unsigned threadCount):
+    _font(font),
+    _firstChar(firstChar),
+    _charCount(charCount),
+    _whiteU(0.0f),
+    _whiteV(0.0f),
+    _fromCache(false)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    if(!cacheFile.empty() && loadCache(cacheFile)) {
+        _fromCache = true;
+    } else {
+        generate(threadCount);
+        if(!cacheFile.empty())
+            saveCache(cacheFile);
+    }
+
+    _loadTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// FNV-1a
+uint32_t SdfFont::fontHash() const
+{
+    uint32_t hash = 2166136261u;
+    for(unsigned char c : _font) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void SdfFont::generate(unsigned threadCount)
+{
+    TRACE_SCOPE("SdfFont::generate");
+
+    stbtt_fontinfo info;
+    if(!stbtt_InitFont(&info, _font.data(), stbtt_GetFontOffsetForIndex(_font.data(), 0)))
+        throw Exception("Invalid font data");
+    float scale = stbtt_ScaleForPixelHeight(&info, (float)BASE_SIZE);
+    float distScale = (float)ON_EDGE / PADDING;
+
+    struct Bitmap {
+        unsigned char* data;
+        int width, height, xoff, yoff;
+    };
+    std::vector<Bitmap> bitmaps(_charCount);
+
+    // Glyphs are independent, hand them out to the threads one by one
+    if(!threadCount)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        int i;
+        while((i = next++) < _charCount) {
+            Bitmap& b = bitmaps[i];
+            b.data = stbtt_GetCodepointSDF(&info, scale, _firstChar + i, PADDING, ON_EDGE, distScale,
+                                           &b.width, &b.height, &b.xoff, &b.yoff);
+        }
+    };
+    std::vector<std::thread> threads;
+    for(unsigned t = 1; t < threadCount; t++)
+        threads.emplace_back(worker);
+    worker();
+    for(auto& thread : threads)
+        thread.join();
+
+    // Pack the largest first
+    std::vector<int> order(_charCount);
+    for(int i = 0; i < _charCount; i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return bitmaps[a].height > bitmaps[b].height;
+    });
+
+    _pixels.assign((size_t)ATLAS_SIZE * ATLAS_SIZE, 0);
+    _glyphs.assign(_charCount, Glyph{});
+    SkylinePacker packer(ATLAS_SIZE, ATLAS_SIZE);
+
+    int wx, wy;
+    packer.pack(3, 3, wx, wy);
+    for(int y = 0; y < 2; y++)
+        memset(&_pixels[(size_t)(wy + y) * ATLAS_SIZE + wx], 255, 2);
+    _whiteU = (wx + 1.0f) / ATLAS_SIZE;
+    _whiteV = (wy + 1.0f) / ATLAS_SIZE;
+
+    for(int i : order) {
+        Bitmap& b = bitmaps[i];
+        Glyph& g = _glyphs[i];
+        g.codepoint = _firstChar + i;
+
+        int advance, leftBearing;
+        stbtt_GetCodepointHMetrics(&info, g.codepoint, &advance, &leftBearing);
+        g.advance = advance * scale;
+
+        if(!b.data)
+            continue;
+
+        int x, y;
+        if(!packer.pack(b.width + 1, b.height + 1, x, y)) {
+            for(auto& bitmap : bitmaps)
+                stbtt_FreeSDF(bitmap.data, nullptr);
+            throw Exception(fmt::format("SDF glyphs do not fit a {}x{} atlas", (int)ATLAS_SIZE, (int)ATLAS_SIZE));
+        }
+        for(int row = 0; row < b.height; row++)
+            memcpy(&_pixels[(size_t)(y + row) * ATLAS_SIZE + x], b.data + row * b.width, b.width);
+
+        g.u0 = (float)x / ATLAS_SIZE;
+        g.v0 = (float)y / ATLAS_SIZE;
+        g.u1 = (float)(x + b.width) / ATLAS_SIZE;
+        g.v1 = (float)(y + b.height) / ATLAS_SIZE;
+        g.x0 = (float)b.xoff;
+        g.y0 = (float)b.yoff;
+        g.x1 = (float)(b.xoff + b.width);
+        g.y1 = (float)(b.yoff + b.height);
+    }
+
+    for(auto& b : bitmaps)
+        stbtt_FreeSDF(b.data, nullptr);
+}
+
+bool SdfFont::loadCache(const std::string& filename)
+{
+    TRACE_SCOPE("SdfFont::loadCache");
+
+    FILE* f = fopen(filename.c_str(), "rb");
+    if(!f)
+        return false;
+
+    sdf_cache_header header;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+              memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+              header.version == CACHE_VERSION &&
+              header.fontHash == fontHash() &&
+              header.baseSize == BASE_SIZE &&
+              header.padding == PADDING &&
+              header.onEdge == ON_EDGE &&
+              header.firstChar == (uint32_t)_firstChar &&
+              header.charCount == (uint32_t)_charCount &&
+              header.width == ATLAS_SIZE &&
+              header.height == ATLAS_SIZE;
+    if(ok) {
+        _glyphs.resize(_charCount);
+        _pixels.resize((size_t)ATLAS_SIZE * ATLAS_SIZE);
+        ok = fread(&_whiteU, sizeof(float), 1, f) == 1 &&
+             fread(&_whiteV, sizeof(float), 1, f) == 1 &&
+             fread(_glyphs.data(), sizeof(Glyph), _glyphs.size(), f) == _glyphs.size() &&
+             fread(_pixels.data(), 1, _pixels.size(), f) == _pixels.size();
+    }
+    fclose(f);
+
+    if(!ok) {
+        _glyphs.clear();
+        _pixels.clear();
+    }
+    return ok;
+}
+
+void SdfFont::saveCache(const std::string& filename) const
+{
+    FILE* f = fopen(filename.c_str(), "wb");
+    if(!f) {
+        fmt::printf("Cannot write SDF cache \"%s\"\n", filename);
+        return;
+    }
+
+    sdf_cache_header header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.fontHash = fontHash();
+    header.baseSize = BASE_SIZE;
+    header.padding = PADDING;
+    header.onEdge = ON_EDGE;
+    header.firstChar = _firstChar;
+    header.charCount = _charCount;
+    header.width = ATLAS_SIZE;
+    header.height = ATLAS_SIZE;
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(&_whiteU, sizeof(float), 1, f) == 1 &&
+              fwrite(&_whiteV, sizeof(float), 1, f) == 1 &&
+              fwrite(_glyphs.data(), sizeof(Glyph), _glyphs.size(), f) == _glyphs.size() &&
+              fwrite(_pixels.data(), 1, _pixels.size(), f) == _pixels.size();
+    fclose(f);
+
+    // Never leave a truncated cache behind
+    if(!ok) {
+        remove(filename.c_str());
+        fmt::printf("Cannot write SDF cache \"%s\"\n", filename);
+    }
+}
+
+bool SdfFont::glyph(uint32_t codepoint, int pixelHeight, glyph_entry& entry) const
+{
+    int index = (int)codepoint - _firstChar;
+    if(index < 0 || index >= _charCount)
+        return false;
+
+    const Glyph& g = _glyphs[index];
+    float scale = (float)pixelHeight / BASE_SIZE;
+    entry.page = g.u1 > g.u0 ? 0 : -1;
+    entry.u0 = g.u0;
+    entry.v0 = g.v0;
+    entry.u1 = g.u1;
+    entry.v1 = g.v1;
+    entry.x0 = g.x0 * scale;
+    entry.y0 = g.y0 * scale;
+    entry.x1 = g.x1 * scale;
+    entry.y1 = g.y1 * scale;
+    entry.advance = g.advance * scale;
+    return true;
+}
+
+void SdfFont::white(float& u, float& v) const
+{
+    u = _whiteU;
+    v = _whiteV;
+}
+
+const unsigned char* SdfFont::pixels() const
+{
+    return _pixels.data();
+}
+
+int SdfFont::width() const
+{
+    return ATLAS_SIZE;
+}
+
+int SdfFont::height() const
+{
+    return ATLAS_SIZE;
+}
+
+double SdfFont::loadTime() const
+{
+    return _loadTime;
+}
+
+bool SdfFont::fromCache() const
+{
+    return _fromCache;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "glyph_atlas.h"
+
+/*
+ * Signed distance field glyphs for scale independent text.
+ *
+ * Every glyph of a codepoint range is turned into a distance field once,
+ * at BASE_SIZE pixels, with stb_truetype's SDF rasterizer (glyphs spread
+ * over threads) and packed into a single channel atlas. The edge sits at
+ * 128 and values fall off over PADDING pixels either side, which the SDF
+ * shader turns back into antialiased coverage at any size.
+ *
+ * Generation results can be cached in a file: the header holds a format
+ * version, a hash of the font data and the generation parameters, and
+ * the cache is rebuilt whenever one of them doesn't match.
+ */
+class SdfFont {
+    public:
+        static const int BASE_SIZE = 48;
+        static const int PADDING = 6;
+        static const int ATLAS_SIZE = 1024;
+        static const unsigned char ON_EDGE = 128;
+
+    private:
+        struct Glyph {
+            uint32_t codepoint;
+            float u0, v0, u1, v1;
+            float x0, y0, x1, y1;       /* At BASE_SIZE, relative to the pen */
+            float advance;
+        };
+
+        std::vector<unsigned char> _font;
+        int _firstChar, _charCount;
+        std::vector<Glyph> _glyphs;     /* Indexed by codepoint - firstChar */
+        std::vector<unsigned char> _pixels;
+        float _whiteU, _whiteV;
+        double _loadTime;
+        bool _fromCache;
+
+    public:
+        // threadCount 0 uses every core
+        SdfFont(const std::vector<unsigned char>& font,
+                const std::string& cacheFile = "",
+                int firstChar = 32, int charCount = 95,
+                unsigned threadCount = 0);
+
+        SdfFont(const SdfFont&) = delete;
+        SdfFont& operator=(const SdfFont&) = delete;
+
+        // Glyph quad scaled to pixelHeight, false outside the range
+        bool glyph(uint32_t codepoint, int pixelHeight, glyph_entry& entry) const;
+        void white(float& u, float& v) const;
+
+        const unsigned char* pixels() const;
+        int width() const;
+        int height() const;
+
+        double loadTime() const;        /* Seconds spent generating or loading */
+        bool fromCache() const;
+
+    private:
+        void generate(unsigned threadCount);
+        bool loadCache(const std::string& filename);
+        void saveCache(const std::string& filename) const;
+        uint32_t fontHash() const;
+};
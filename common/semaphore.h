@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/*
+ * Counting semaphore that stays on atomics unless a thread has to sleep.
+ *
+ * wait() spins for a little while before blocking, and signal() only
+ * touches the mutex when someone is actually blocked, so handing work
+ * back and forth between two busy threads never takes a lock.
+ */
+class Semaphore {
+    public:
+        static const int SPIN_COUNT = 256;
+
+    private:
+        std::atomic<int> _count;        /* Negative: number of blocked waiters */
+        std::mutex _mutex;
+        std::condition_variable _wakeup;
+        int _wakeups;                   /* Signals meant for blocked waiters, under _mutex */
+
+    public:
+        explicit Semaphore(int count = 0):
+            _count(count),
+            _wakeups(0)
+        {
+        }
+
+        Semaphore(const Semaphore&) = delete;
+        Semaphore& operator=(const Semaphore&) = delete;
+
+        void signal()
+        {
+            if(_count.fetch_add(1, std::memory_order_release) < 0) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _wakeups++;
+                _wakeup.notify_one();
+            }
+        }
+
+        bool tryWait()
+        {
+            int count = _count.load(std::memory_order_relaxed);
+            while(count > 0) {
+                if(_count.compare_exchange_weak(count, count - 1,
+                                                std::memory_order_acquire,
+                                                std::memory_order_relaxed))
+                    return true;
+            }
+            return false;
+        }
+
+        void wait()
+        {
+            for(int i = 0; i < SPIN_COUNT; i++) {
+                if(tryWait())
+                    return;
+                std::this_thread::yield();
+            }
+            if(_count.fetch_sub(1, std::memory_order_acquire) > 0)
+                return;
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wakeup.wait(lock, [this] { return _wakeups > 0; });
+            _wakeups--;
+        }
+};
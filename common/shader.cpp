@@ -1,13 +1,21 @@
 #include "shader.h"
+#include "asset_registry.h"
 #include "exception.h"
+#include "gl_ext.h"
+#include "scene_state.h"
+#include "trace.h"
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <glad/glad.h>
 #include <fmt/format.h>
+#include <fmt/printf.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <cassert>
 
+static unsigned uniformUpdateCount = 0;
+static unsigned programGenerationCount = 0;
+
 static std::string readFile(const std::string& filename)
 {
     std::string result;
@@ -24,93 +32,263 @@ static std::string readFile(const std::string& filename)
     return ss.str();
 }
 
-static unsigned int compileShader(GLenum type, const std::string& filename)
+static const char* shaderType(GLenum type)
+{
+    switch(type) {
+        case GL_VERTEX_SHADER:
+            return "vertex shader";
+        case GL_FRAGMENT_SHADER:
+            return "fragment shader";
+        default:
+            return "unknown shader";
+    }
+}
+
+// Compile without waiting on the result, see checkShader(). Chains the
+// source into key.
+static unsigned int compileShader(GLenum type, const std::string& filename, uint64_t& key)
 {
+    TRACE_SCOPE("compileShader");
     std::string contents = readFile(filename);
+    key = state_hash(contents, key);
 
     unsigned int shader = glCreateShader(type);
     const char* sources[1] = { contents.c_str() };
     glShaderSource(shader, 1, sources, NULL);
     glCompileShader(shader);
 
+    return shader;
+}
+
+static void checkShader(unsigned int shader, GLenum type, const std::string& filename)
+{
     int success;
     char msg[512];
     glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
     if(!success) {
         glGetShaderInfoLog(shader, sizeof(msg), NULL, msg);
 
-        const char* stype = NULL;
-        switch(type) {
-            case GL_VERTEX_SHADER:
-                stype = "vertex shader";
-                break;
-            case GL_FRAGMENT_SHADER:
-                stype = "fragment shader";
-                break;
-            default:
-                stype = "unknown shader";
-                break;
-        }
-
         std::string smsg = fmt::format("Error compiling {} from \"{}\": {}",
-                                       stype,
+                                       shaderType(type),
                                        filename,
                                        msg);
         throw Exception(smsg);
     }
-
-    return shader;
 }
 
-Shader::Shader(std::string vertexShaderFile, std::string fragmentShaderFile)
+// Start compiling and linking, the driver may do it in the background.
+// Returns the key of the sources, see Shader::sourceKey().
+static uint64_t buildProgram(unsigned int build[3],
+                             const std::string& vertexShaderFile,
+                             const std::string& fragmentShaderFile)
 {
-    unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderFile);
-    unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderFile);
- 
+    uint64_t key = STATE_HASH_SEED;
+    build[1] = compileShader(GL_VERTEX_SHADER, vertexShaderFile, key);
+    try {
+        build[2] = compileShader(GL_FRAGMENT_SHADER, fragmentShaderFile, key);
+    } catch(...) {
+        glDeleteShader(build[1]);
+        throw;
+    }
+
     // Shader program (link vertex & fragment shader)
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
+    build[0] = glCreateProgram();
+    glAttachShader(build[0], build[1]);
+    glAttachShader(build[0], build[2]);
+    glLinkProgram(build[0]);
+    return key;
+}
 
-    int success;
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if(!success) {
-        char msg[512];
-        glGetProgramInfoLog(shaderProgram, sizeof(msg), NULL, msg);
+static bool buildComplete(const unsigned int build[3])
+{
+    if(!glext::parallelShaderCompile)
+        return true;
 
-        auto smsg = fmt::format("Error linking shader program from \"{}\" and \"{}\": {}",
-                                vertexShaderFile, fragmentShaderFile,
-                                msg);
-        throw Exception(smsg);
+    int complete;
+    glGetProgramiv(build[0], GL_COMPLETION_STATUS_ARB, &complete);
+    return complete != 0;
+}
+
+// Wait for the build and check it, returns the program
+static unsigned int finishProgram(unsigned int build[3],
+                                  const std::string& vertexShaderFile,
+                                  const std::string& fragmentShaderFile)
+{
+    try {
+        checkShader(build[1], GL_VERTEX_SHADER, vertexShaderFile);
+        checkShader(build[2], GL_FRAGMENT_SHADER, fragmentShaderFile);
+
+        int success;
+        glGetProgramiv(build[0], GL_LINK_STATUS, &success);
+        if(!success) {
+            char msg[512];
+            glGetProgramInfoLog(build[0], sizeof(msg), NULL, msg);
+
+            auto smsg = fmt::format("Error linking shader program from \"{}\" and \"{}\": {}",
+                                    vertexShaderFile, fragmentShaderFile,
+                                    msg);
+            throw Exception(smsg);
+        }
+    } catch(...) {
+        glDeleteShader(build[1]);
+        glDeleteShader(build[2]);
+        glDeleteProgram(build[0]);
+        throw;
     }
 
     // Shaders can be deleted once they are linked into the program
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);  
+    glDeleteShader(build[1]);
+    glDeleteShader(build[2]);
+
+    return build[0];
+}
+
+Shader::Shader(std::string vertexShaderFile, std::string fragmentShaderFile):
+    _pendingKey(0),
+    _vertexShaderFile(vertexShaderFile),
+    _fragmentShaderFile(fragmentShaderFile),
+    _pending{}
+{
+    TRACE_SCOPE("Shader::Shader");
+    unsigned int build[3];
+    _key = buildProgram(build, vertexShaderFile, fragmentShaderFile);
+    _id = finishProgram(build, vertexShaderFile, fragmentShaderFile);
+    watch();
+}
 
-    _id = shaderProgram;
+Shader::Shader(std::string vertexShaderFile, std::string fragmentShaderFile,
+               unsigned int program, uint64_t key):
+    _id(program),
+    _key(key),
+    _pendingKey(0),
+    _vertexShaderFile(vertexShaderFile),
+    _fragmentShaderFile(fragmentShaderFile),
+    _pending{}
+{
+    watch();
 }
 
+// Registrations point at the object, moves register anew
 Shader::Shader(Shader&& shader) noexcept:
-    _id(shader._id)
+    _id(shader._id),
+    _key(shader._key),
+    _pendingKey(0),
+    _vertexShaderFile(std::move(shader._vertexShaderFile)),
+    _fragmentShaderFile(std::move(shader._fragmentShaderFile)),
+    _pending{}
 {
+    shader.unwatch();
+    shader.deletePending();
     shader._id = 0;
+    watch();
 }
 
 Shader& Shader::operator=(Shader&& shader) noexcept
 {
     if(this != &shader) {
+        unwatch();
+        deletePending();
+        if(_id)
+            deleteProgram(_id);
+
+        shader.unwatch();
+        shader.deletePending();
         _id = shader._id;
+        _key = shader._key;
+        _vertexShaderFile = std::move(shader._vertexShaderFile);
+        _fragmentShaderFile = std::move(shader._fragmentShaderFile);
         shader._id = 0;
+        watch();
     }
     return *this;
 }
 
 Shader::~Shader()
 {
+    unwatch();
+    deletePending();
     if(_id)
-        glDeleteProgram(_id);
+        deleteProgram(_id);
+}
+
+unsigned int Shader::release()
+{
+    deletePending();
+    unsigned int id = _id;
+    _id = 0;
+    return id;
+}
+
+void Shader::watch()
+{
+    AssetRegistry& registry = AssetRegistry::instance();
+    _watches[0] = registry.watch(_vertexShaderFile, [this]() { reload(); });
+    _watches[1] = registry.watch(_fragmentShaderFile, [this]() { reload(); });
+}
+
+void Shader::unwatch()
+{
+    AssetRegistry& registry = AssetRegistry::instance();
+    for(unsigned& id : _watches) {
+        if(id)
+            registry.unwatch(id);
+        id = 0;
+    }
+}
+
+void Shader::deletePending()
+{
+    if(!_pending[0])
+        return;
+    glDeleteShader(_pending[1]);
+    glDeleteShader(_pending[2]);
+    glDeleteProgram(_pending[0]);
+    _pending[0] = _pending[1] = _pending[2] = 0;
+}
+
+void Shader::reload()
+{
+    TRACE_SCOPE("Shader::reload");
+
+    // A newer edit supersedes the build in flight
+    bool queued = _pending[0] != 0;
+    deletePending();
+    try {
+        _pendingKey = buildProgram(_pending, _vertexShaderFile, _fragmentShaderFile);
+    } catch(std::exception& e) {
+        fmt::printf("%s\n", e.what());
+        _pending[0] = _pending[1] = _pending[2] = 0;
+        return;
+    }
+
+    if(!queued)
+        AssetRegistry::instance().defer(_watches[0], [this]() { return finishReload(); });
+}
+
+bool Shader::reloading() const
+{
+    return _pending[0] != 0;
+}
+
+bool Shader::finishReload()
+{
+    if(!_pending[0])
+        return true;
+    if(!buildComplete(_pending))
+        return false;
+
+    try {
+        unsigned int program = finishProgram(_pending, _vertexShaderFile, _fragmentShaderFile);
+        if(_id)
+            deleteProgram(_id);
+        _id = program;
+        _key = _pendingKey;
+        fmt::printf("Reloaded shader \"%s\", \"%s\"\n", _vertexShaderFile, _fragmentShaderFile);
+    } catch(std::exception& e) {
+        fmt::printf("%s\n", e.what());
+    }
+    _pending[0] = _pending[1] = _pending[2] = 0;
+    return true;
 }
 
 void Shader::use()
@@ -123,6 +301,19 @@ unsigned int Shader::getId() const
     return _id;
 }
 
+uint64_t Shader::key() const
+{
+    return _key;
+}
+
+uint64_t Shader::sourceKey(const std::string& vertexShaderFile,
+                           const std::string& fragmentShaderFile)
+{
+    uint64_t key = STATE_HASH_SEED;
+    key = state_hash(readFile(vertexShaderFile), key);
+    return state_hash(readFile(fragmentShaderFile), key);
+}
+
 void Shader::setBool(const std::string& name, bool value) const
 {
     setInt(name, (int)value);
@@ -133,6 +324,7 @@ void Shader::setInt(const std::string& name, int value) const
     int location = glGetUniformLocation(_id, name.c_str());
     assert(location != -1);
 
+    uniformUpdateCount++;
     glUniform1i(location, (int)value);
 }
 
@@ -141,6 +333,7 @@ void Shader::setFloat(const std::string& name, float value) const
     int location = glGetUniformLocation(_id, name.c_str());
     assert(location != -1);
 
+    uniformUpdateCount++;
     glUniform1f(location, value);
 }
 
@@ -149,6 +342,7 @@ void Shader::setMatrix(const std::string& name, const glm::mat4& value) const
     int location = glGetUniformLocation(_id, name.c_str());
     assert(location != -1);
 
+    uniformUpdateCount++;
     glUniformMatrix4fv(location,
                        1,                           /* Number of matrices to send */
                        GL_FALSE,                    /* Transpose? */
@@ -162,6 +356,7 @@ void Shader::setVec3(const std::string& name, float x, float y, float z) const
     int location = glGetUniformLocation(_id, name.c_str());
     assert(location != -1);
 
+    uniformUpdateCount++;
     glUniform3f(location,
                 x,
                 y,
@@ -173,3 +368,24 @@ void Shader::setVec3(const std::string& name, const glm::vec3& v) const
     setVec3(name, v.x, v.y, v.z);
 }
 
+unsigned Shader::uniformUpdates()
+{
+    return uniformUpdateCount;
+}
+
+void Shader::resetUniformUpdates()
+{
+    uniformUpdateCount = 0;
+}
+
+void Shader::deleteProgram(unsigned int program)
+{
+    glDeleteProgram(program);
+    programGenerationCount++;
+}
+
+unsigned Shader::programGeneration()
+{
+    return programGenerationCount;
+}
+
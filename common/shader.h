@@ -1,11 +1,23 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <glm/glm.hpp>
 
+/*
+ * GLSL program built from a vertex and a fragment shader file.
+ *
+ * Both files are registered with the AssetRegistry: when one changes the
+ * program is rebuilt, in the background when the driver supports
+ * parallel shader compilation, and swapped in once linked. The previous
+ * program stays in use if the new one fails to compile. Uniforms are
+ * looked up on every set, so they just need setting again each frame.
+ */
 class Shader {
     public:
         Shader(std::string vertexShaderFile, std::string fragmentShaderFile);
+        Shader(std::string vertexShaderFile, std::string fragmentShaderFile,
+               unsigned int program, uint64_t key);    /* Adopts program, built from sources with key */
         Shader(Shader&&) noexcept;
         Shader& operator=(Shader&&) noexcept;
         ~Shader();
@@ -22,7 +34,40 @@ class Shader {
         void setVec3(const std::string& name, float x, float y, float z) const;
         void setVec3(const std::string& name, const glm::vec3& v) const;
 
+        // Gives up ownership of the program, which the object no longer deletes
+        unsigned int release();
+
+        // Hash of the sources the current program was built from, and of
+        // what is on disk now
+        uint64_t key() const;
+        static uint64_t sourceKey(const std::string& vertexShaderFile,
+                                  const std::string& fragmentShaderFile);
+
+        // Rebuild from the source files, keeps the current program on failure
+        void reload();
+        bool reloading() const;
+
+        // glUniform* calls made through the setters, for all shaders
+        static unsigned uniformUpdates();
+        static void resetUniformUpdates();
+
+        // Deletes a program and bumps programGeneration(), so caches keyed
+        // by program name can tell when a name may have been reused
+        static void deleteProgram(unsigned int program);
+        static unsigned programGeneration();
+
     private:
         unsigned int _id;
+        uint64_t _key;
+        uint64_t _pendingKey;
+        std::string _vertexShaderFile;
+        std::string _fragmentShaderFile;
+        unsigned int _pending[3];       /* Program, vertex and fragment shader being built */
+        unsigned _watches[2];
+
+        void watch();
+        void unwatch();
+        bool finishReload();
+        void deletePending();
 };
 
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/*
+ * Bounded lock-free queue for exactly one producer and one consumer
+ * thread. Slots are allocated up front, capacity is rounded up to a power
+ * of two. push() fails instead of blocking when the queue is full.
+ */
+template<typename T>
+class SpscQueue {
+    private:
+        std::vector<T> _items;
+        size_t _mask;
+        std::atomic<size_t> _head;      /* Next slot to pop, written by the consumer */
+        char _padding[64];              /* Keep head and tail on separate cache lines */
+        std::atomic<size_t> _tail;      /* Next slot to push, written by the producer */
+
+    public:
+        explicit SpscQueue(size_t capacity):
+            _head(0),
+            _tail(0)
+        {
+            size_t size = 1;
+            while(size < capacity)
+                size *= 2;
+            _items.resize(size);
+            _mask = size - 1;
+        }
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        bool push(T item)
+        {
+            size_t tail = _tail.load(std::memory_order_relaxed);
+            if(tail - _head.load(std::memory_order_acquire) == _items.size())
+                return false;
+            _items[tail & _mask] = std::move(item);
+            _tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool pop(T& item)
+        {
+            size_t head = _head.load(std::memory_order_relaxed);
+            if(head == _tail.load(std::memory_order_acquire))
+                return false;
+            item = std::move(_items[head & _mask]);
+            _head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool empty() const
+        {
+            return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+        }
+
+        size_t capacity() const
+        {
+            return _items.size();
+        }
+};
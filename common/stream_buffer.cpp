@@ -0,0 +1,146 @@
+#include "stream_buffer.h"
+#include "gl_ext.h"
+#include "exception.h"
+
+#include <chrono>
+#include <cstring>
+#include <fmt/format.h>
+
+// Keeps every region start aligned for UBO/SSBO bindings
+static const size_t REGION_ALIGNMENT = 256;
+
+StreamBuffer::StreamBuffer(GLenum target, size_t frameSize):
+    _target(target),
+    _id(0),
+    _frameSize((frameSize + REGION_ALIGNMENT - 1) & ~(REGION_ALIGNMENT - 1)),
+    _mapped(nullptr),
+    _frame(0),
+    _used(0),
+    _frameStarted(false),
+    _stats{}
+{
+    for(int i = 0; i < FRAME_COUNT; i++)
+        _fences[i] = 0;
+
+    glGenBuffers(1, &_id);
+    glBindBuffer(_target, _id);
+    if(glext::bufferStorage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glext::BufferStorage(_target, _frameSize * FRAME_COUNT, nullptr, flags);
+        _mapped = (unsigned char*)glMapBufferRange(_target, 0, _frameSize * FRAME_COUNT, flags);
+        if(!_mapped)
+            throw Exception(fmt::format("Cannot map stream buffer of {} bytes", _frameSize * FRAME_COUNT));
+    } else {
+        glBufferData(_target, _frameSize, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(_target, 0);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    for(int i = 0; i < FRAME_COUNT; i++) {
+        if(_fences[i])
+            glDeleteSync(_fences[i]);
+    }
+    if(_mapped) {
+        glBindBuffer(_target, _id);
+        glUnmapBuffer(_target);
+        glBindBuffer(_target, 0);
+    }
+    glDeleteBuffers(1, &_id);
+}
+
+void StreamBuffer::beginFrame()
+{
+    if(_mapped) {
+        GLsync fence = _fences[_frame];
+        if(fence) {
+            GLenum result = glClientWaitSync(fence, 0, 0);
+            if(result == GL_TIMEOUT_EXPIRED) {
+                _stats.stalls++;
+                auto start = std::chrono::steady_clock::now();
+                do {
+                    result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+                } while(result == GL_TIMEOUT_EXPIRED);
+                _stats.stallTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            glDeleteSync(fence);
+            _fences[_frame] = 0;
+        }
+    } else {
+        glBindBuffer(_target, _id);
+        glBufferData(_target, _frameSize, nullptr, GL_STREAM_DRAW);
+        _stats.orphans++;
+    }
+
+    _used = 0;
+    _frameStarted = true;
+}
+
+size_t StreamBuffer::write(const void* data, size_t size, size_t alignment)
+{
+    if(!_frameStarted)
+        beginFrame();
+
+    size_t start = alignment > 1 ? (_used + alignment - 1) / alignment * alignment : _used;
+    if(start + size > _frameSize)
+        throw Exception(fmt::format("Stream buffer overflow: {} bytes requested, {} of {} used",
+                                    size, _used, _frameSize));
+
+    size_t offset;
+    if(_mapped) {
+        offset = _frame * _frameSize + start;
+        memcpy(_mapped + offset, data, size);
+    } else {
+        offset = start;
+        glBindBuffer(_target, _id);
+        glBufferSubData(_target, offset, size, data);
+    }
+
+    _used = start + size;
+    _stats.bytesWritten += size;
+    return offset;
+}
+
+void StreamBuffer::endFrame()
+{
+    if(!_frameStarted)
+        return;
+
+    if(_mapped) {
+        _fences[_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        _frame = (_frame + 1) % FRAME_COUNT;
+    }
+    _frameStarted = false;
+    _stats.frames++;
+}
+
+GLuint StreamBuffer::id() const
+{
+    return _id;
+}
+
+GLenum StreamBuffer::target() const
+{
+    return _target;
+}
+
+size_t StreamBuffer::frameSize() const
+{
+    return _frameSize;
+}
+
+size_t StreamBuffer::used() const
+{
+    return _used;
+}
+
+bool StreamBuffer::persistent() const
+{
+    return _mapped != nullptr;
+}
+
+const StreamBufferStats& StreamBuffer::stats() const
+{
+    return _stats;
+}
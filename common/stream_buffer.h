@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <glad/glad.h>
+
+struct StreamBufferStats {
+    unsigned frames;
+    unsigned stalls;            /* Frames where the CPU had to wait for the GPU */
+    double stallTime;           /* Seconds spent waiting */
+    unsigned orphans;           /* Buffer reallocations (orphaning path only) */
+    size_t bytesWritten;
+};
+
+/*
+ * Ring buffer for data rewritten every frame (instance data, uniform
+ * blocks, dynamic vertices).
+ *
+ * With GL 4.4 / ARB_buffer_storage the buffer is mapped once, persistent
+ * and coherent, and split into FRAME_COUNT regions. Each frame writes into
+ * its own region; endFrame() fences it and moves to the next one, waiting
+ * only if the GPU is still reading that region from FRAME_COUNT frames ago.
+ *
+ * On GL 3.3 the buffer is orphaned at the start of every frame and
+ * written with glBufferSubData, letting the driver do the buffering.
+ *
+ * Offsets returned by write() are relative to id(), ready for
+ * glBindBufferRange or as indirect/vertex buffer offsets.
+ */
+class StreamBuffer {
+    public:
+        static const int FRAME_COUNT = 3;
+
+    private:
+        GLenum _target;
+        GLuint _id;
+        size_t _frameSize;
+        unsigned char* _mapped;     /* Persistent mapping, null when orphaning */
+        GLsync _fences[FRAME_COUNT];
+        int _frame;
+        size_t _used;
+        bool _frameStarted;
+        StreamBufferStats _stats;
+
+    public:
+        StreamBuffer(GLenum target, size_t frameSize);
+        ~StreamBuffer();
+
+        StreamBuffer(const StreamBuffer&) = delete;
+        StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+        // Copy data into the current frame's region and return its offset.
+        // Throws if the region is full.
+        size_t write(const void* data, size_t size, size_t alignment = 16);
+
+        // Call once all the draws using this frame's data were issued
+        void endFrame();
+
+        GLuint id() const;
+        GLenum target() const;
+        size_t frameSize() const;
+        size_t used() const;
+        bool persistent() const;
+        const StreamBufferStats& stats() const;
+
+    private:
+        void beginFrame();
+};
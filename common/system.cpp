@@ -2,12 +2,15 @@
 #include "exception.h"
 
 #include <unistd.h>
+#ifdef __APPLE__
 #include <mach-o/dyld.h>
+#endif
 #include <libgen.h>
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <string.h>
 
 #include <system_error>
 
@@ -42,6 +45,16 @@ string sys::exepath(int argc, const char* const* argv)
     string result(buffer);
     free(buffer);
     return result;
+#elif defined(__linux__)
+    vector<char> buffer(512);
+    while(true) {
+        ssize_t ret = readlink("/proc/self/exe", buffer.data(), buffer.size());
+        if(ret == -1)
+            throw errno_exception();
+        if((size_t)ret < buffer.size())
+            return string(buffer.data(), ret);
+        buffer.resize(buffer.size() * 2);
+    }
 #else
 #error "Not implemented yet"
 #endif
@@ -72,15 +85,44 @@ vector<unsigned char> sys::readfile(const string& filename)
 
         if(ret == 0)
             break;
-        else if(ret == -1)
-            throw errno_exception();
+        else if(ret == -1) {
+            int code = errno;
+            close(fd);
+            throw errno_exception(code);
+        }
 
         result.insert(result.end(), buffer, buffer + ret);
     }
 
+    close(fd);
     return result;
 }
 
+void sys::writefile(const string& filename, const vector<unsigned char>& data, int mode)
+{
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if(fd == -1) {
+        throw errno_exception();
+    }
+
+    size_t written = 0;
+    while(written < data.size()) {
+        ssize_t ret;
+        do {
+            ret = write(fd, data.data() + written, data.size() - written);
+        } while(ret == -1 && errno == EINTR);
+
+        if(ret == -1) {
+            int code = errno;
+            close(fd);
+            throw errno_exception(code);
+        }
+        written += ret;
+    }
+
+    close(fd);
+}
+
 std::exception sys::errno_exception()
 {
     return errno_exception(errno);
@@ -9,6 +9,7 @@ namespace sys {
     std::string exepath(int argc, const char* const* argv);
     bool exists(const std::string& path);
     std::vector<unsigned char> readfile(const std::string& filename);
+    void writefile(const std::string& filename, const std::vector<unsigned char>& data, int mode = 0644);
     std::exception errno_exception();
     std::exception errno_exception(int code);
 }
@@ -0,0 +1,156 @@
+#include "text_batch.h"
+#include "sdf_font.h"
+
+#include <algorithm>
+#include <cstring>
+
+// 0xRRGGBBAA to bytes in memory order, as read by GL_UNSIGNED_BYTE attributes
+static uint32_t packColor(uint32_t rgba)
+{
+    unsigned char bytes[4] = {
+        (unsigned char)(rgba >> 24),
+        (unsigned char)(rgba >> 16),
+        (unsigned char)(rgba >> 8),
+        (unsigned char)rgba
+    };
+    uint32_t result;
+    memcpy(&result, bytes, sizeof(result));
+    return result;
+}
+
+// Next codepoint of a UTF-8 string, U+FFFD for malformed sequences
+static uint32_t decodeUtf8(const char*& p, const char* end)
+{
+    unsigned char c = *p++;
+    if(c < 0x80)
+        return c;
+
+    int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : -1;
+    if(extra < 0)
+        return 0xFFFD;
+
+    uint32_t codepoint = c & (0x3F >> extra);
+    for(int i = 0; i < extra; i++) {
+        if(p == end || ((unsigned char)*p & 0xC0) != 0x80)
+            return 0xFFFD;
+        codepoint = (codepoint << 6) | ((unsigned char)*p++ & 0x3F);
+    }
+    return codepoint;
+}
+
+TextBatch::TextBatch(GlyphAtlas& atlas, size_t reserveQuads):
+    _atlas(&atlas),
+    _sdf(nullptr)
+{
+    _vertices.reserve(reserveQuads * 4);
+}
+
+TextBatch::TextBatch(const SdfFont& sdf, size_t reserveQuads):
+    _atlas(nullptr),
+    _sdf(&sdf)
+{
+    _vertices.reserve(reserveQuads * 4);
+}
+
+bool TextBatch::glyph(uint32_t codepoint, int pixelHeight, glyph_entry& entry)
+{
+    if(_sdf)
+        return _sdf->glyph(codepoint, pixelHeight, entry);
+
+    const glyph_entry* cached = _atlas->glyph(codepoint, pixelHeight);
+    if(!cached)
+        return false;
+    entry = *cached;
+    return true;
+}
+
+void TextBatch::clear()
+{
+    _vertices.clear();
+}
+
+void TextBatch::quad(float x0, float y0, float x1, float y1,
+                     float u0, float v0, float u1, float v1,
+                     uint32_t color)
+{
+    text_vertex v[4] = {
+        { x0, y0, u0, v0, color },
+        { x1, y0, u1, v0, color },
+        { x1, y1, u1, v1, color },
+        { x0, y1, u0, v1, color },
+    };
+    _vertices.insert(_vertices.end(), v, v + 4);
+}
+
+void TextBatch::text(float x, float y, const char* text, size_t length, uint32_t color, int pixelHeight)
+{
+    uint32_t packed = packColor(color);
+    float startX = x;
+    const char* end = text + length;
+    for(const char* p = text; p < end; ) {
+        uint32_t codepoint = decodeUtf8(p, end);
+        if(codepoint == '\n') {
+            x = startX;
+            y += pixelHeight;
+            continue;
+        }
+
+        glyph_entry entry;
+        if(!glyph(codepoint, pixelHeight, entry))
+            continue;
+        if(entry.page >= 0) {
+            quad(x + entry.x0, y + entry.y0, x + entry.x1, y + entry.y1,
+                 entry.u0, entry.v0, entry.u1, entry.v1,
+                 packed);
+        }
+        x += entry.advance;
+    }
+}
+
+void TextBatch::text(float x, float y, const std::string& text, uint32_t color, int pixelHeight)
+{
+    this->text(x, y, text.data(), text.size(), color, pixelHeight);
+}
+
+void TextBatch::rect(float x, float y, float width, float height, uint32_t color)
+{
+    float u, v;
+    if(_sdf)
+        _sdf->white(u, v);
+    else
+        _atlas->white(u, v);
+    quad(x, y, x + width, y + height, u, v, u, v, packColor(color));
+}
+
+float TextBatch::textWidth(const std::string& text, int pixelHeight)
+{
+    float width = 0.0f, x = 0.0f;
+    const char* end = text.data() + text.size();
+    for(const char* p = text.data(); p < end; ) {
+        uint32_t codepoint = decodeUtf8(p, end);
+        if(codepoint == '\n') {
+            x = 0.0f;
+            continue;
+        }
+        glyph_entry entry;
+        if(glyph(codepoint, pixelHeight, entry))
+            x += entry.advance;
+        width = std::max(width, x);
+    }
+    return width;
+}
+
+const text_vertex* TextBatch::vertices() const
+{
+    return _vertices.data();
+}
+
+size_t TextBatch::vertexCount() const
+{
+    return _vertices.size();
+}
+
+size_t TextBatch::quadCount() const
+{
+    return _vertices.size() / 4;
+}
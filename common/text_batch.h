@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "glyph_atlas.h"
+
+class SdfFont;
+
+struct text_vertex {
+    float x, y;
+    float u, v;
+    uint32_t color;             /* RGBA bytes in memory order */
+};
+
+/*
+ * CPU side of the text renderer: lays out UTF-8 strings with the glyph
+ * atlas and appends 4 vertices per quad (to be drawn with a shared quad
+ * index buffer). Vertex storage is kept between frames, so once it has
+ * grown to the frame's size batching allocates nothing.
+ *
+ * Glyphs come either from a GlyphAtlas, rasterized per pixel size, or
+ * from an SdfFont whose quads are scaled to the requested size.
+ *
+ * Coordinates are in pixels, origin at the top-left, y on the baseline.
+ * Colors are 0xRRGGBBAA.
+ */
+class TextBatch {
+    private:
+        GlyphAtlas* _atlas;
+        const SdfFont* _sdf;
+        std::vector<text_vertex> _vertices;
+
+    public:
+        TextBatch(GlyphAtlas& atlas, size_t reserveQuads = 4096);
+        TextBatch(const SdfFont& sdf, size_t reserveQuads = 4096);
+
+        void clear();
+        void text(float x, float y, const char* text, size_t length, uint32_t color, int pixelHeight);
+        void text(float x, float y, const std::string& text, uint32_t color, int pixelHeight);
+        void rect(float x, float y, float width, float height, uint32_t color);
+
+        float textWidth(const std::string& text, int pixelHeight);
+
+        const text_vertex* vertices() const;
+        size_t vertexCount() const;
+        size_t quadCount() const;
+
+    private:
+        bool glyph(uint32_t codepoint, int pixelHeight, glyph_entry& entry);
+        void quad(float x0, float y0, float x1, float y1,
+                  float u0, float v0, float u1, float v1,
+                  uint32_t color);
+};
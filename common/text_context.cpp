@@ -0,0 +1,261 @@
+#include "text_context.h"
+#include "glyph_atlas.h"
+#include "sdf_font.h"
+#include "shader.h"
+#include "stream_buffer.h"
+#include "system.h"
+#include "text_batch.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include <fmt/format.h>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+class text_context_impl {
+    public:
+        Shader shader;
+        std::unique_ptr<GlyphAtlas> atlas;
+        std::unique_ptr<SdfFont> sdf;
+        std::unique_ptr<TextBatch> batch;
+        GLuint texture;
+        GLuint vao;
+        GLuint indexBuffer;
+        size_t indexedQuads;            /* Quads covered by the index buffer */
+        std::unique_ptr<StreamBuffer> vertices;
+        int pixelHeight;
+        int width, height;
+
+        text_context_impl(const std::string& fontFile,
+                          const std::string& vertexShaderFile,
+                          const std::string& fragmentShaderFile,
+                          float pixelHeight,
+                          bool sdf,
+                          const std::string& sdfCacheFile);
+        ~text_context_impl();
+
+        void reserve(size_t quads);
+        void upload();
+};
+
+text_context_impl::text_context_impl(const std::string& fontFile,
+                                     const std::string& vertexShaderFile,
+                                     const std::string& fragmentShaderFile,
+                                     float pixelHeight,
+                                     bool sdf,
+                                     const std::string& sdfCacheFile):
+    shader(vertexShaderFile, fragmentShaderFile),
+    texture(0),
+    vao(0),
+    indexBuffer(0),
+    indexedQuads(0),
+    pixelHeight((int)(pixelHeight + 0.5f)),
+    width(1),
+    height(1)
+{
+    // Distance fields must be filtered, coverage glyphs are pixel exact
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if(sdf) {
+        this->sdf.reset(new SdfFont(sys::readfile(fontFile), sdfCacheFile));
+        batch.reset(new TextBatch(*this->sdf));
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, this->sdf->width(), this->sdf->height(), 0,
+                     GL_RED, GL_UNSIGNED_BYTE, this->sdf->pixels());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    } else {
+        atlas.reset(new GlyphAtlas(sys::readfile(fontFile)));
+        batch.reset(new TextBatch(*atlas));
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlas->width(), atlas->height(), 0,
+                     GL_RED, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &indexBuffer);
+    reserve(4096);
+}
+
+text_context_impl::~text_context_impl()
+{
+    vertices.reset();
+    glDeleteTextures(1, &texture);
+    glDeleteBuffers(1, &indexBuffer);
+    glDeleteVertexArrays(1, &vao);
+}
+
+// Grow the index and streaming vertex buffers to hold quads
+void text_context_impl::reserve(size_t quads)
+{
+    if(quads <= indexedQuads)
+        return;
+    quads = std::max(quads, indexedQuads * 2);
+
+    std::vector<GLuint> indices(quads * 6);
+    for(size_t i = 0; i < quads; i++) {
+        GLuint base = (GLuint)(i * 4);
+        GLuint* index = &indices[i * 6];
+        index[0] = base;
+        index[1] = base + 1;
+        index[2] = base + 2;
+        index[3] = base;
+        index[4] = base + 2;
+        index[5] = base + 3;
+    }
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+
+    vertices.reset(new StreamBuffer(GL_ARRAY_BUFFER, quads * 4 * sizeof(text_vertex)));
+    indexedQuads = quads;
+}
+
+// Send the atlas pixels rasterized since the last frame
+void text_context_impl::upload()
+{
+    if(!atlas || !atlas->dirty())
+        return;
+
+    int x, y, w, h;
+    atlas->dirtyRect(x, y, w, h);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, atlas->width());
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RED, GL_UNSIGNED_BYTE,
+                    atlas->pixels() + (size_t)y * atlas->width() + x);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    atlas->clearDirty();
+}
+
+text_context::text_context(const std::string& fontFile,
+                           const std::string& vertexShaderFile,
+                           const std::string& fragmentShaderFile,
+                           float pixelHeight,
+                           bool sdf,
+                           const std::string& sdfCacheFile):
+    impl(std::make_shared<text_context_impl>(fontFile, vertexShaderFile, fragmentShaderFile,
+                                             pixelHeight, sdf, sdfCacheFile))
+{
+}
+
+void text_context::begin(int width, int height)
+{
+    impl->width = width;
+    impl->height = height;
+    impl->batch->clear();
+    if(impl->atlas)
+        impl->atlas->beginFrame();
+}
+
+void text_context::drawText(float x, float y, const std::string& text, uint32_t color)
+{
+    impl->batch->text(x, y, text, color, impl->pixelHeight);
+}
+
+void text_context::drawText(float x, float y, const std::string& text, uint32_t color, int pixelHeight)
+{
+    impl->batch->text(x, y, text, color, pixelHeight);
+}
+
+void text_context::drawRect(float x, float y, float width, float height, uint32_t color)
+{
+    impl->batch->rect(x, y, width, height, color);
+}
+
+void text_context::draw()
+{
+    impl->upload();
+
+    size_t quads = impl->batch->quadCount();
+    if(!quads)
+        return;
+    impl->reserve(quads);
+
+    size_t offset = impl->vertices->write(impl->batch->vertices(),
+                                          impl->batch->vertexCount() * sizeof(text_vertex),
+                                          sizeof(float));
+
+    // The stream buffer offset moves every frame, point the attributes at it
+    glBindVertexArray(impl->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, impl->vertices->id());
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(text_vertex),
+                          BUFFER_OBJECT(offset + offsetof(text_vertex, x)));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(text_vertex),
+                          BUFFER_OBJECT(offset + offsetof(text_vertex, u)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(text_vertex),
+                          BUFFER_OBJECT(offset + offsetof(text_vertex, color)));
+    glEnableVertexAttribArray(2);
+
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    impl->shader.use();
+    impl->shader.setMatrix("projection", glm::ortho(0.0f, (float)impl->width, (float)impl->height, 0.0f, -1.0f, 1.0f));
+    impl->shader.setInt("texture1", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, impl->texture);
+    glDrawElements(GL_TRIANGLES, (GLsizei)(quads * 6), GL_UNSIGNED_INT, BUFFER_OBJECT(0));
+    glBindVertexArray(0);
+
+    impl->vertices->endFrame();
+
+    if(depthTest)
+        glEnable(GL_DEPTH_TEST);
+    if(!blend)
+        glDisable(GL_BLEND);
+}
+
+float text_context::textWidth(const std::string& text) const
+{
+    return impl->batch->textWidth(text, impl->pixelHeight);
+}
+
+float text_context::lineHeight() const
+{
+    return (float)impl->pixelHeight;
+}
+
+unsigned text_context::quadCount() const
+{
+    return (unsigned)impl->batch->quadCount();
+}
+
+const GlyphAtlas* text_context::atlas() const
+{
+    return impl->atlas.get();
+}
+
+const SdfFont* text_context::sdfFont() const
+{
+    return impl->sdf.get();
+}
+
+std::shared_ptr<text_context> make_text_context(const context& ctx, float pixelHeight, bool sdf)
+{
+    // Not next to the font, res/ is watched and may be the source tree
+    std::string cacheFile;
+    if(sdf && !ctx.cacheDir.empty())
+        cacheFile = fmt::format("{}/dos.ttf.sdf", ctx.cacheDir);
+
+    return std::make_shared<text_context>(fmt::format("{}/dos.ttf", ctx.resDir),
+                                          fmt::format("{}/text_shader.vs", ctx.resDir),
+                                          fmt::format("{}/{}", ctx.resDir, sdf ? "text_shader_sdf.fs" : "text_shader.fs"),
+                                          pixelHeight,
+                                          sdf,
+                                          cacheFile);
+}
@@ -1,18 +1,50 @@
 #pragma once
 
 #include "context.h"
+#include <cstdint>
 #include <memory>
+#include <string>
 
 class text_context_impl;
+class GlyphAtlas;
+class SdfFont;
 
-class text_context : public context {
+/*
+ * Batched screen space text.
+ *
+ * Between begin() and draw(), drawText() and drawRect() only append quads
+ * (see TextBatch), at any pixel size, glyphs being cached on demand in a
+ * GlyphAtlas. draw() uploads the atlas regions that changed, streams all
+ * the vertices and issues one draw call with blending on and depth test
+ * off. Coordinates are in pixels, origin at the top-left corner, y being
+ * the text baseline. Colors are 0xRRGGBBAA.
+ *
+ * In SDF mode glyphs come from a distance field atlas built once (see
+ * SdfFont) and stay sharp at any size, given the SDF fragment shader.
+ * make_text_context() caches that atlas under context::cacheDir.
+ */
+class text_context {
     private:
         std::shared_ptr<text_context_impl> impl;
     public:
-        text_context();
-        void draw(float ticks);
-        void drawText(float x, float y, const std::string& text);
-};
+        text_context(const std::string& fontFile,
+                     const std::string& vertexShaderFile,
+                     const std::string& fragmentShaderFile,
+                     float pixelHeight,
+                     bool sdf = false,
+                     const std::string& sdfCacheFile = "");   /* Empty builds the SDF atlas every time */
+
+        void begin(int width, int height);
+        void drawText(float x, float y, const std::string& text, uint32_t color = 0xFFFFFFFF);
+        void drawText(float x, float y, const std::string& text, uint32_t color, int pixelHeight);
+        void drawRect(float x, float y, float width, float height, uint32_t color);
+        void draw();
 
-std::shared_ptr<text_context> make_text_context();
+        float textWidth(const std::string& text) const;
+        float lineHeight() const;
+        unsigned quadCount() const;
+        const GlyphAtlas* atlas() const;        /* Null in SDF mode */
+        const SdfFont* sdfFont() const;
+};
 
+std::shared_ptr<text_context> make_text_context(const context& ctx, float pixelHeight = 16.0f, bool sdf = false);
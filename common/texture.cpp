@@ -0,0 +1,185 @@
+#include "texture.h"
+#include "asset_registry.h"
+#include "file_watcher.h"
+#include "image.h"
+#include "scene_state.h"
+#include "trace.h"
+
+#include <chrono>
+#include <glad/glad.h>
+#include <fmt/printf.h>
+
+// The version is taken before reading, a later change gets reloaded
+Texture::Texture(const std::string& filename, bool flip):
+    _id(0),
+    _key(sourceKey(filename)),
+    _decodingKey(0),
+    _filename(filename),
+    _flip(flip),
+    _width(0),
+    _height(0),
+    _stale(false)
+{
+    Image image(filename, flip);
+    glGenTextures(1, &_id);
+    upload(image);
+
+    _watch = AssetRegistry::instance().watch(filename, [this]() { reload(); });
+}
+
+Texture::Texture(const std::string& filename, const Image& image, uint64_t key, bool flip):
+    _id(0),
+    _key(key),
+    _decodingKey(0),
+    _filename(filename),
+    _flip(flip),
+    _width(0),
+    _height(0),
+    _stale(false)
+{
+    glGenTextures(1, &_id);
+    upload(image);
+
+    _watch = AssetRegistry::instance().watch(filename, [this]() { reload(); });
+}
+
+Texture::Texture(const std::string& filename, unsigned int id, uint64_t key, bool flip):
+    _id(id),
+    _key(key),
+    _decodingKey(0),
+    _filename(filename),
+    _flip(flip),
+    _width(0),
+    _height(0),
+    _stale(false)
+{
+    glBindTexture(GL_TEXTURE_2D, _id);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &_width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &_height);
+
+    _watch = AssetRegistry::instance().watch(filename, [this]() { reload(); });
+}
+
+Texture::~Texture()
+{
+    AssetRegistry::instance().unwatch(_watch);
+    if(_decoding.valid())
+        _decoding.wait();
+    if(_id)
+        glDeleteTextures(1, &_id);
+}
+
+unsigned int Texture::release()
+{
+    unsigned int id = _id;
+    _id = 0;
+    return id;
+}
+
+uint64_t Texture::key() const
+{
+    return _key;
+}
+
+uint64_t Texture::sourceKey(const std::string& filename)
+{
+    timespec mtime = {};
+    file_mtime(filename, mtime);
+    return state_hash(&mtime.tv_nsec, sizeof(mtime.tv_nsec),
+                      state_hash(&mtime.tv_sec, sizeof(mtime.tv_sec), state_hash(filename)));
+}
+
+unsigned int Texture::id() const
+{
+    return _id;
+}
+
+int Texture::width() const
+{
+    return _width;
+}
+
+int Texture::height() const
+{
+    return _height;
+}
+
+// Drivers store RGB8 as RGBA8, plus a third for the mip chain
+size_t Texture::memorySize() const
+{
+    return (size_t)_width * _height * 4 * 4 / 3;
+}
+
+void Texture::upload(const Image& image)
+{
+    TRACE_SCOPE("Texture::upload");
+    glBindTexture(GL_TEXTURE_2D, _id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glTexImage2D(GL_TEXTURE_2D,
+                 0,
+                 GL_RGB,
+                 image.getWidth(), image.getHeight(),
+                 0,
+                 image.getChannels() == 3 ? GL_RGB : GL_RGBA,
+                 GL_UNSIGNED_BYTE,
+                 image.getData());
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    _width = image.getWidth();
+    _height = image.getHeight();
+}
+
+void Texture::reload()
+{
+    // Still decoding the previous version, finishReload() starts over
+    if(_decoding.valid()) {
+        _stale = true;
+        return;
+    }
+
+    decode();
+    AssetRegistry::instance().defer(_watch, [this]() { return finishReload(); });
+}
+
+void Texture::decode()
+{
+    std::string filename = _filename;
+    bool flip = _flip;
+    _decodingKey = sourceKey(filename);
+    _decoding = std::async(std::launch::async, [filename, flip]() {
+        return std::make_shared<Image>(filename, flip);
+    });
+    _stale = false;
+}
+
+bool Texture::reloading() const
+{
+    return _decoding.valid();
+}
+
+bool Texture::finishReload()
+{
+    if(_decoding.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return false;
+    if(_stale) {
+        try {
+            _decoding.get();
+        } catch(std::exception&) {
+        }
+        decode();
+        return false;
+    }
+
+    try {
+        upload(*_decoding.get());
+        _key = _decodingKey;
+        fmt::printf("Reloaded texture \"%s\"\n", _filename);
+    } catch(std::exception& e) {
+        fmt::printf("%s\n", e.what());
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+
+class Image;
+
+/*
+ * Mipmapped 2D texture loaded from an image file.
+ *
+ * The file is registered with the AssetRegistry: on change it is decoded
+ * again on a background thread and uploaded into the same texture object
+ * once ready, so ids held elsewhere stay valid. A file that fails to
+ * decode leaves the current contents in place.
+ */
+class Texture {
+    private:
+        unsigned int _id;
+        uint64_t _key;
+        uint64_t _decodingKey;
+        std::string _filename;
+        bool _flip;
+        int _width, _height;
+        unsigned _watch;
+        std::future<std::shared_ptr<Image>> _decoding;
+        bool _stale;                    /* Changed again while decoding */
+
+    public:
+        Texture(const std::string& filename, bool flip = false);
+        Texture(const std::string& filename, const Image& image, uint64_t key, bool flip = false);    /* Already decoded, from the version key */
+        Texture(const std::string& filename, unsigned int id, uint64_t key, bool flip = false);       /* Adopts id */
+        ~Texture();
+
+        Texture(const Texture&) = delete;
+        Texture& operator=(const Texture&) = delete;
+
+        unsigned int id() const;
+        int width() const;
+        int height() const;
+        size_t memorySize() const;      /* Estimate, RGBA8 with the mip chain */
+
+        // Gives up ownership of the texture object, which is no longer deleted
+        unsigned int release();
+
+        // Version of the file the contents were decoded from, and the
+        // version on disk now (name and modification time)
+        uint64_t key() const;
+        static uint64_t sourceKey(const std::string& filename);
+
+        void reload();
+        bool reloading() const;
+
+    private:
+        void upload(const Image& image);
+        void decode();
+        bool finishReload();
+};
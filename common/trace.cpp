@@ -0,0 +1,142 @@
+#include "trace.h"
+#include "exception.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+#include <fmt/printf.h>
+
+namespace {
+    struct registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<trace::thread_buffer>> buffers;    /* Kept for flush after their thread exits */
+        std::vector<trace::thread_buffer*> free;                        /* Of exited threads, for the next ones */
+        uint64_t baseTicks;
+        uint64_t baseNs;
+
+        registry():
+            baseTicks(trace::timestamp()),
+            baseNs(trace::nowNs())
+        {
+        }
+    };
+
+    registry& getRegistry()
+    {
+        static registry r;
+        return r;
+    }
+
+    // Hands the thread's buffer back when the thread exits
+    struct buffer_holder {
+        trace::thread_buffer* buffer;
+
+        ~buffer_holder()
+        {
+            if(!buffer)
+                return;
+            registry& r = getRegistry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.free.push_back(buffer);
+            trace::currentBuffer = nullptr;
+        }
+    };
+
+    thread_local buffer_holder holder = { nullptr };
+}
+
+thread_local trace::thread_buffer* trace::currentBuffer = nullptr;
+
+uint64_t trace::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+trace::thread_buffer* trace::createThreadBuffer()
+{
+    registry& r = getRegistry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    // Short-lived threads, like the reload workers, keep recycling the same
+    // few rings. The ring carries on from where it was, so the previous
+    // thread's events stay until overwritten.
+    if(!r.free.empty()) {
+        currentBuffer = r.free.back();
+        r.free.pop_back();
+        currentBuffer->name = fmt::format("thread {}", currentBuffer->tid);
+    } else {
+        std::unique_ptr<thread_buffer> buffer(new thread_buffer);
+        buffer->count.store(0);
+        buffer->tid = (uint32_t)r.buffers.size() + 1;
+        buffer->name = fmt::format("thread {}", buffer->tid);
+
+        currentBuffer = buffer.get();
+        r.buffers.push_back(std::move(buffer));
+    }
+
+    holder.buffer = currentBuffer;
+    return currentBuffer;
+}
+
+void trace::setThreadName(const std::string& name)
+{
+    thread_buffer* buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(getRegistry().mutex);
+    buffer->name = name;
+}
+
+void trace::flush(const std::string& filename)
+{
+    registry& r = getRegistry();
+
+    // Ticks to nanoseconds, measured over the lifetime of the registry
+    uint64_t ticks = timestamp();
+    uint64_t ns = nowNs();
+    while(ns - r.baseNs < 10000000) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ticks = timestamp();
+        ns = nowNs();
+    }
+    double nsPerTick = double(ns - r.baseNs) / double(ticks - r.baseTicks);
+
+    FILE* f = fopen(filename.c_str(), "w");
+    if(!f)
+        throw Exception(fmt::format("Cannot write trace \"{}\"", filename));
+
+    fmt::fprintf(f, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    bool first = true;
+
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::vector<event> events;
+    for(const auto& buffer : r.buffers) {
+        fmt::fprintf(f, "%s  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"%s\"}}",
+                     first ? "" : ",\n", buffer->tid, buffer->name);
+        first = false;
+
+        // Copy, then drop whatever the owner may have overwritten meanwhile
+        uint64_t end = buffer->count.load(std::memory_order_acquire);
+        uint64_t begin = end > thread_buffer::CAPACITY ? end - thread_buffer::CAPACITY : 0;
+        events.clear();
+        for(uint64_t i = begin; i < end; i++)
+            events.push_back(buffer->events[i & (thread_buffer::CAPACITY - 1)]);
+        uint64_t written = buffer->count.load(std::memory_order_acquire);
+        uint64_t valid = written > thread_buffer::CAPACITY ? written - thread_buffer::CAPACITY : 0;
+        size_t skip = valid > begin ? (size_t)(valid - begin) : 0;
+
+        for(size_t i = skip; i < events.size(); i++) {
+            const event& e = events[i];
+            double ts = (int64_t)(e.begin - r.baseTicks) * nsPerTick / 1000.0;
+            double dur = (e.end - e.begin) * nsPerTick / 1000.0;
+            fmt::fprintf(f, ",\n  {\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+                         e.name, buffer->tid, ts, dur);
+        }
+    }
+
+    fmt::fprintf(f, "\n]}\n");
+    fclose(f);
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/*
+ * Low overhead scope tracing.
+ *
+ * Every thread appends to its own ring buffer of completed scopes (name,
+ * begin and end timestamps from the cycle counter); the owning thread is
+ * the only writer so recording takes no lock. flush() converts the rings
+ * to Chrome trace JSON (chrome://tracing, ui.perfetto.dev). When a ring
+ * wraps, the oldest scopes are lost. The ring of a thread that exits is
+ * taken over by the next thread to trace, so memory is bounded by the
+ * number of threads alive at once; the earlier thread's scopes then show
+ * under the new thread's name.
+ *
+ * Scope names are kept as pointers until flush(), so they must be string
+ * literals of a module that stays loaded; not the hot-reloaded scene.
+ *
+ * The TRACE_* macros compile to nothing unless GLTUT_TRACE is defined.
+ */
+namespace trace {
+    struct event {
+        const char* name;       /* Must be a string literal */
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    struct thread_buffer {
+        static const size_t CAPACITY = 1 << 16;
+
+        event events[CAPACITY];
+        std::atomic<uint64_t> count;    /* Total events written, wraps the ring */
+        uint32_t tid;
+        std::string name;
+    };
+
+    extern thread_local thread_buffer* currentBuffer;
+    thread_buffer* createThreadBuffer();
+
+    inline thread_buffer* threadBuffer()
+    {
+        thread_buffer* buffer = currentBuffer;
+        if(!buffer)
+            buffer = createThreadBuffer();
+        return buffer;
+    }
+
+    uint64_t nowNs();
+
+    inline uint64_t timestamp()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        uint32_t lo, hi;
+        __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+        return ((uint64_t)hi << 32) | lo;
+#elif defined(__aarch64__)
+        uint64_t value;
+        __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(value));
+        return value;
+#else
+        return nowNs();
+#endif
+    }
+
+    inline void record(const char* name, uint64_t begin, uint64_t end)
+    {
+        thread_buffer* buffer = threadBuffer();
+        uint64_t n = buffer->count.load(std::memory_order_relaxed);
+        event& e = buffer->events[n & (thread_buffer::CAPACITY - 1)];
+        e.name = name;
+        e.begin = begin;
+        e.end = end;
+        buffer->count.store(n + 1, std::memory_order_release);
+    }
+
+    // Label the calling thread in the trace
+    void setThreadName(const std::string& name);
+
+    // Write every thread's events so far; safe while other threads trace
+    void flush(const std::string& filename);
+
+    class Scope {
+        private:
+            const char* _name;
+            uint64_t _begin;
+
+        public:
+            Scope(const char* name):
+                _name(name),
+                _begin(timestamp())
+            {
+            }
+
+            ~Scope()
+            {
+                record(_name, _begin, timestamp());
+            }
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+    };
+}
+
+#ifdef GLTUT_TRACE
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) trace::Scope TRACE_CONCAT(traceScope_, __COUNTER__)(name)
+#define TRACE_FUNCTION() TRACE_SCOPE(__func__)
+#define TRACE_THREAD_NAME(name) trace::setThreadName(name)
+#define TRACE_FLUSH(filename) trace::flush(filename)
+#else
+#define TRACE_SCOPE(name) do {} while(0)
+#define TRACE_FUNCTION() do {} while(0)
+#define TRACE_THREAD_NAME(name) do {} while(0)
+#define TRACE_FLUSH(filename) do {} while(0)
+#endif
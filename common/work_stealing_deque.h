@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Bounded Chase-Lev deque of pointers. The owner thread pushes and pops
+ * at the bottom, LIFO, any other thread steals from the top, FIFO. Only
+ * the last item is contended, which a CAS on top settles.
+ *
+ * Capacity is rounded up to a power of two and never grows: push() fails
+ * when full and the caller runs the item itself.
+ */
+template<typename T>
+class WorkStealingDeque {
+    private:
+        std::vector<std::atomic<T*>> _items;
+        int64_t _mask;
+        std::atomic<int64_t> _top;      /* Next to steal */
+        char _padding[64];              /* Keep top and bottom on separate cache lines */
+        std::atomic<int64_t> _bottom;   /* Next to push, owner only */
+
+    public:
+        explicit WorkStealingDeque(size_t capacity):
+            _top(0),
+            _bottom(0)
+        {
+            size_t size = 1;
+            while(size < capacity)
+                size *= 2;
+            _items = std::vector<std::atomic<T*>>(size);
+            _mask = (int64_t)size - 1;
+        }
+
+        WorkStealingDeque(const WorkStealingDeque&) = delete;
+        WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+        // Owner only
+        bool push(T* item)
+        {
+            int64_t bottom = _bottom.load(std::memory_order_relaxed);
+            int64_t top = _top.load(std::memory_order_acquire);
+            if(bottom - top > _mask)
+                return false;
+            _items[bottom & _mask].store(item, std::memory_order_relaxed);
+            _bottom.store(bottom + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Owner only
+        T* pop()
+        {
+            int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+            _bottom.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t top = _top.load(std::memory_order_relaxed);
+
+            if(top > bottom) {
+                _bottom.store(bottom + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            T* item = _items[bottom & _mask].load(std::memory_order_relaxed);
+            if(top == bottom) {
+                // Last one, race the thieves for it
+                if(!_top.compare_exchange_strong(top, top + 1,
+                                                 std::memory_order_seq_cst,
+                                                 std::memory_order_relaxed))
+                    item = nullptr;
+                _bottom.store(bottom + 1, std::memory_order_relaxed);
+            }
+            return item;
+        }
+
+        // Any thread
+        T* steal()
+        {
+            int64_t top = _top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t bottom = _bottom.load(std::memory_order_acquire);
+            if(top >= bottom)
+                return nullptr;
+
+            T* item = _items[top & _mask].load(std::memory_order_relaxed);
+            if(!_top.compare_exchange_strong(top, top + 1,
+                                             std::memory_order_seq_cst,
+                                             std::memory_order_relaxed))
+                return nullptr;
+            return item;
+        }
+
+        // Approximate unless called by the owner
+        size_t size() const
+        {
+            int64_t size = _bottom.load(std::memory_order_relaxed) - _top.load(std::memory_order_relaxed);
+            return size > 0 ? (size_t)size : 0;
+        }
+
+        size_t capacity() const
+        {
+            return (size_t)_mask + 1;
+        }
+};
@@ -0,0 +1,141 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <fmt/format.h>
+#include <fmt/printf.h>
+
+#include "exception.h"
+
+struct distribution {
+    double mean, stddev, min, p50, p95, p99, max;
+};
+
+static distribution summarize(const std::vector<frame_sample>& samples,
+                              std::function<double(const frame_sample&)> field)
+{
+    std::vector<double> values;
+    values.reserve(samples.size());
+    for(const auto& sample : samples)
+        values.push_back(field(sample));
+
+    distribution d = {};
+    if(values.empty())
+        return d;
+
+    std::sort(values.begin(), values.end());
+    auto at = [&](double p) {
+        return values[std::min(values.size() - 1, (size_t)(p * (values.size() - 1) + 0.5))];
+    };
+
+    double sum = 0.0;
+    for(double v : values)
+        sum += v;
+    d.mean = sum / values.size();
+    double squares = 0.0;
+    for(double v : values)
+        squares += (v - d.mean) * (v - d.mean);
+    d.stddev = values.size() > 1 ? sqrt(squares / (values.size() - 1)) : 0.0;
+    d.min = values.front();
+    d.p50 = at(0.50);
+    d.p95 = at(0.95);
+    d.p99 = at(0.99);
+    d.max = values.back();
+    return d;
+}
+
+static std::string toJson(const distribution& d)
+{
+    return fmt::format("{{\"mean\": {:.4f}, \"stddev\": {:.4f}, \"min\": {:.4f}, \"p50\": {:.4f}, "
+                       "\"p95\": {:.4f}, \"p99\": {:.4f}, \"max\": {:.4f}}}",
+                       d.mean, d.stddev, d.min, d.p50, d.p95, d.p99, d.max);
+}
+
+static double average(const std::vector<frame_sample>& samples, unsigned frame_stats::*field)
+{
+    if(samples.empty())
+        return 0.0;
+    double sum = 0.0;
+    for(const auto& sample : samples)
+        sum += sample.stats.*field;
+    return sum / samples.size();
+}
+
+void FrameRecorder::reserve(size_t count)
+{
+    _samples.reserve(count);
+}
+
+void FrameRecorder::add(const frame_sample& sample)
+{
+    _samples.push_back(sample);
+}
+
+size_t FrameRecorder::size() const
+{
+    return _samples.size();
+}
+
+void FrameRecorder::printSummary() const
+{
+    distribution frame = summarize(_samples, [](const frame_sample& s) { return s.frameMs; });
+    distribution cpu = summarize(_samples, [](const frame_sample& s) { return s.cpuMs; });
+    distribution gpu = summarize(_samples, [](const frame_sample& s) { return s.gpuMs; });
+
+    fmt::printf("  frame ms:    p50 %.3f  p95 %.3f  p99 %.3f  max %.3f  stddev %.3f\n",
+                frame.p50, frame.p95, frame.p99, frame.max, frame.stddev);
+    fmt::printf("  cpu ms:      p50 %.3f  p95 %.3f  p99 %.3f  max %.3f\n", cpu.p50, cpu.p95, cpu.p99, cpu.max);
+    fmt::printf("  gpu ms:      p50 %.3f  p95 %.3f  p99 %.3f  max %.3f\n", gpu.p50, gpu.p95, gpu.p99, gpu.max);
+    fmt::printf("  draw calls:  %.1f per frame\n", average(_samples, &frame_stats::drawCalls));
+}
+
+void FrameRecorder::writeJson(const std::string& filename,
+                              const std::string& label,
+                              int width, int height) const
+{
+    FILE* f = fopen(filename.c_str(), "w");
+    if(!f)
+        throw Exception(fmt::format("Cannot write benchmark results \"{}\"", filename));
+
+    distribution frame = summarize(_samples, [](const frame_sample& s) { return s.frameMs; });
+    distribution cpu = summarize(_samples, [](const frame_sample& s) { return s.cpuMs; });
+    distribution gpu = summarize(_samples, [](const frame_sample& s) { return s.gpuMs; });
+
+    std::string escaped;
+    for(char c : label) {
+        if(c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+
+    fmt::fprintf(f, "{\n");
+    fmt::fprintf(f, "  \"label\": \"%s\",\n", escaped);
+    fmt::fprintf(f, "  \"frames\": %d,\n", (int)_samples.size());
+    fmt::fprintf(f, "  \"width\": %d,\n", width);
+    fmt::fprintf(f, "  \"height\": %d,\n", height);
+    fmt::fprintf(f, "  \"frame_ms\": %s,\n", toJson(frame));
+    fmt::fprintf(f, "  \"cpu_ms\": %s,\n", toJson(cpu));
+    fmt::fprintf(f, "  \"gpu_ms\": %s,\n", toJson(gpu));
+    fmt::fprintf(f, "  \"per_frame\": {\n");
+    fmt::fprintf(f, "    \"draw_calls\": %.2f,\n", average(_samples, &frame_stats::drawCalls));
+    fmt::fprintf(f, "    \"culled_objects\": %.2f,\n", average(_samples, &frame_stats::culledObjects));
+    fmt::fprintf(f, "    \"program_binds\": %.2f,\n", average(_samples, &frame_stats::programBinds));
+    fmt::fprintf(f, "    \"vao_binds\": %.2f,\n", average(_samples, &frame_stats::vaoBinds));
+    fmt::fprintf(f, "    \"texture_binds\": %.2f,\n", average(_samples, &frame_stats::textureBinds));
+    fmt::fprintf(f, "    \"buffer_stalls\": %.2f\n", average(_samples, &frame_stats::bufferStalls));
+    fmt::fprintf(f, "  },\n");
+
+    fmt::fprintf(f, "  \"sample_fields\": [\"frame_ms\", \"cpu_ms\", \"gpu_ms\", \"draw_calls\"],\n");
+    fmt::fprintf(f, "  \"samples\": [\n");
+    for(size_t i = 0; i < _samples.size(); i++) {
+        const auto& s = _samples[i];
+        fmt::fprintf(f, "    [%.4f, %.4f, %.4f, %u]%s\n",
+                     s.frameMs, s.cpuMs, s.gpuMs, s.stats.drawCalls,
+                     i + 1 < _samples.size() ? "," : "");
+    }
+    fmt::fprintf(f, "  ]\n");
+    fmt::fprintf(f, "}\n");
+    fclose(f);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "context.h"
+
+struct frame_sample {
+    double frameMs;             /* Wall time including glFinish */
+    double cpuMs;               /* Time to submit the frame */
+    double gpuMs;               /* GL_TIME_ELAPSED */
+    frame_stats stats;
+};
+
+// Per-frame measurements of a benchmark run and their summary
+class FrameRecorder {
+    private:
+        std::vector<frame_sample> _samples;
+
+    public:
+        void reserve(size_t count);
+        void add(const frame_sample& sample);
+        size_t size() const;
+
+        void printSummary() const;
+
+        // Summary with p50/p95/p99 plus the raw per-frame times, for
+        // comparing runs across commits
+        void writeJson(const std::string& filename,
+                       const std::string& label,
+                       int width, int height) const;
+};
@@ -0,0 +1,115 @@
+#include "camera_path.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fmt/format.h>
+
+#include "exception.h"
+
+void CameraPath::load(const std::string& filename)
+{
+    FILE* f = fopen(filename.c_str(), "r");
+    if(!f)
+        throw Exception(fmt::format("Cannot open camera path \"{}\"", filename));
+
+    _keys.clear();
+    char line[256];
+    int lineNo = 0;
+    while(fgets(line, sizeof(line), f)) {
+        lineNo++;
+        const char* p = line;
+        while(*p == ' ' || *p == '\t')
+            p++;
+        if(*p == '#' || *p == '\n' || *p == '\r' || *p == 0)
+            continue;
+
+        camera_keyframe key;
+        if(sscanf(p, "%f %f %f %f %f %f",
+                  &key.time,
+                  &key.position.x, &key.position.y, &key.position.z,
+                  &key.yaw, &key.pitch) != 6 ||
+           (!_keys.empty() && key.time < _keys.back().time)) {
+            fclose(f);
+            throw Exception(fmt::format("{}:{}: invalid keyframe", filename, lineNo));
+        }
+        _keys.push_back(key);
+    }
+    fclose(f);
+
+    if(_keys.empty())
+        throw Exception(fmt::format("Camera path \"{}\" is empty", filename));
+}
+
+void CameraPath::save(const std::string& filename) const
+{
+    FILE* f = fopen(filename.c_str(), "w");
+    if(!f)
+        throw Exception(fmt::format("Cannot write camera path \"{}\"", filename));
+
+    fprintf(f, "# time x y z yaw pitch\n");
+    for(const auto& key : _keys) {
+        fprintf(f, "%.4f %.4f %.4f %.4f %.3f %.3f\n",
+                key.time,
+                key.position.x, key.position.y, key.position.z,
+                key.yaw, key.pitch);
+    }
+    fclose(f);
+}
+
+void CameraPath::clear()
+{
+    _keys.clear();
+}
+
+void CameraPath::add(float time, const Camera& camera)
+{
+    _keys.push_back(camera_keyframe{time, camera.position(), camera.yaw(), camera.pitch()});
+}
+
+Camera CameraPath::sample(float time) const
+{
+    if(_keys.empty())
+        return Camera();
+
+    auto next = std::upper_bound(_keys.begin(), _keys.end(), time,
+                                 [](float t, const camera_keyframe& key) { return t < key.time; });
+    if(next == _keys.begin())
+        next++;
+    if(next == _keys.end()) {
+        const auto& key = _keys.back();
+        return Camera(key.position, glm::vec3(0.0f, 1.0f, 0.0f), key.yaw, key.pitch);
+    }
+
+    const auto& a = *(next - 1);
+    const auto& b = *next;
+    float span = b.time - a.time;
+    float t = span > 0.0f ? glm::clamp((time - a.time) / span, 0.0f, 1.0f) : 1.0f;
+
+    // Yaw is unbounded after mouse look, take the short way around
+    float yawDelta = fmodf(b.yaw - a.yaw, 360.0f);
+    if(yawDelta > 180.0f)
+        yawDelta -= 360.0f;
+    else if(yawDelta < -180.0f)
+        yawDelta += 360.0f;
+
+    return Camera(glm::mix(a.position, b.position, t),
+                  glm::vec3(0.0f, 1.0f, 0.0f),
+                  a.yaw + yawDelta * t,
+                  a.pitch + (b.pitch - a.pitch) * t);
+}
+
+bool CameraPath::empty() const
+{
+    return _keys.empty();
+}
+
+size_t CameraPath::size() const
+{
+    return _keys.size();
+}
+
+float CameraPath::duration() const
+{
+    return _keys.empty() ? 0.0f : _keys.back().time - _keys.front().time;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "camera.h"
+
+struct camera_keyframe {
+    float time;
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+};
+
+/*
+ * Recorded camera flight. The file format is one keyframe per line:
+ *   time x y z yaw pitch
+ * Blank lines and lines starting with '#' are ignored.
+ */
+class CameraPath {
+    private:
+        std::vector<camera_keyframe> _keys;
+
+    public:
+        void load(const std::string& filename);
+        void save(const std::string& filename) const;
+
+        void clear();
+        // Keyframes must be added in increasing time order
+        void add(float time, const Camera& camera);
+
+        // Linear interpolation between keyframes, clamped to the path ends
+        Camera sample(float time) const;
+
+        bool empty() const;
+        size_t size() const;
+        float duration() const;
+};
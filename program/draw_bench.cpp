@@ -0,0 +1,132 @@
+#include "draw_bench.h"
+
+#include <cmath>
+#include <vector>
+#include <fmt/format.h>
+#include <fmt/printf.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "context.h"
+#include "headless.h"
+#include "indirect_draw.h"
+#include "meshes.h"
+#include "offscreen.h"
+#include "shader.h"
+
+struct draw_bench_result {
+    double submitMs;            /* Mean IndirectBatch::submit() time */
+    double gpuMs;               /* Mean GL_TIME_ELAPSED of the submit */
+    unsigned drawCalls;
+};
+
+// The first frame sizes the stream buffers and isn't counted
+static draw_bench_result measure(IndirectBatch& batch, Shader& shader,
+                                 const std::vector<glm::mat4>& models,
+                                 int frames, GLuint query)
+{
+    draw_bench_result result = {};
+    shader.use();
+    for(int frame = 0; frame <= frames; frame++) {
+        glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+        batch.clear();
+        for(const auto& model : models)
+            batch.add(36, 0, model);
+
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        batch.submit(GL_TRIANGLES);
+        glEndQuery(GL_TIME_ELAPSED);
+        glFinish();
+
+        GLuint64 gpuTime = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpuTime);
+        if(frame == 0)
+            continue;
+
+        result.submitMs += batch.stats().submitTime * 1000.0;
+        result.gpuMs += gpuTime / 1e6;
+        result.drawCalls = batch.stats().drawCalls;
+    }
+    result.submitMs /= frames;
+    result.gpuMs /= frames;
+    return result;
+}
+
+static void printResult(const char* label, const draw_bench_result& result, int draws)
+{
+    fmt::printf("  %-9s submit %8.3f ms (%.3f ms per 10k draws), gpu %8.3f ms, %u draw calls\n",
+                label, result.submitMs, result.submitMs * 10000.0 / draws,
+                result.gpuMs, result.drawCalls);
+}
+
+int runDrawBench(const headless_options& options, context& ctx)
+{
+    ctx.windowWidth = options.width;
+    ctx.windowHeight = options.height;
+
+    Offscreen target(options.width, options.height);
+    target.bind();
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
+
+    GLuint vao, vbo;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(cube1), cube1, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), BUFFER_OBJECT(0));
+    glEnableVertexAttribArray(0);
+
+    // One small cube per draw on a square grid filling the viewport
+    int draws = options.drawBench;
+    int side = (int)std::ceil(std::sqrt((double)draws));
+    std::vector<glm::mat4> models;
+    models.reserve(draws);
+    for(int i = 0; i < draws; i++) {
+        auto model = glm::translate(glm::mat4(1.0f), glm::vec3(i % side + 0.5f, i / side + 0.5f, 0.0f));
+        models.push_back(glm::scale(model, glm::vec3(0.5f)));
+    }
+    glm::mat4 projection = glm::ortho(0.0f, (float)side, 0.0f, (float)side, -1.0f, 1.0f);
+
+    GLuint query;
+    glGenQueries(1, &query);
+
+    fmt::printf("draw bench: %d draws, %d frames at %dx%d\n",
+                draws, options.frames, options.width, options.height);
+
+    Shader fallbackShader(fmt::format("{}/lamp.vs", ctx.resDir),
+                          fmt::format("{}/lamp.fs", ctx.resDir));
+    fallbackShader.use();
+    fallbackShader.setMatrix("view", glm::mat4(1.0f));
+    fallbackShader.setMatrix("projection", projection);
+
+    IndirectBatch fallbackBatch;
+    fallbackBatch.setForceFallback(true);
+    fallbackBatch.reserve(draws);
+    draw_bench_result fallback = measure(fallbackBatch, fallbackShader, models, options.frames, query);
+    printResult("per-draw", fallback, draws);
+
+    if(IndirectBatch::supported()) {
+        Shader indirectShader(fmt::format("{}/lamp_indirect.vs", ctx.resDir),
+                              fmt::format("{}/lamp.fs", ctx.resDir));
+        indirectShader.use();
+        indirectShader.setMatrix("view", glm::mat4(1.0f));
+        indirectShader.setMatrix("projection", projection);
+
+        IndirectBatch indirectBatch;
+        indirectBatch.reserve(draws);
+        draw_bench_result indirect = measure(indirectBatch, indirectShader, models, options.frames, query);
+        printResult("indirect", indirect, draws);
+        if(indirect.submitMs > 0.0)
+            fmt::printf("  indirect submit is %.1fx faster\n", fallback.submitMs / indirect.submitMs);
+    } else {
+        fmt::printf("  indirect  not supported by this context\n");
+    }
+
+    glDeleteQueries(1, &query);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    target.unbind();
+    return 0;
+}
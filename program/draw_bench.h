@@ -0,0 +1,14 @@
+#pragma once
+
+struct context;
+struct headless_options;
+
+/*
+ * Submit the same batch of small cubes through IndirectBatch once per
+ * frame, first forced onto the per-draw fallback and then, when the
+ * driver supports it, through multi-draw indirect, and print the submit
+ * time per 10k draws of each path. Runs into an offscreen framebuffer
+ * without the scene libraries, so a software renderer under xvfb is
+ * enough. Needs a current GL context.
+ */
+int runDrawBench(const headless_options& options, context& ctx);
@@ -0,0 +1,106 @@
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <fmt/format.h>
+#include <fmt/printf.h>
+#include <GLFW/glfw3.h>
+
+#include "trace.h"
+
+const int FramePacer::HISTORY;
+
+static const std::chrono::microseconds MIN_SPIN_MARGIN(200);
+static const std::chrono::microseconds MAX_SPIN_MARGIN(4000);
+
+FramePacer::FramePacer(const pacing_options& options):
+    _options(options),
+    _adaptive(false),
+    _period(clock::duration::zero()),
+    _spinMargin(std::chrono::microseconds(1000)),
+    _next(0),
+    _count(0)
+{
+    if(_options.fpsLimit > 0.0)
+        _period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / _options.fpsLimit));
+    std::fill(_frameTimes, _frameTimes + HISTORY, 0.0);
+    _deadline = _lastFrame = clock::now();
+}
+
+void FramePacer::apply()
+{
+    // Negative intervals tear late frames instead of waiting for the next vblank
+    _adaptive = _options.adaptive && _options.swapInterval > 0 &&
+                (glfwExtensionSupported("WGL_EXT_swap_control_tear") ||
+                 glfwExtensionSupported("GLX_EXT_swap_control_tear"));
+    if(_options.adaptive && !_adaptive)
+        fmt::printf("Adaptive vsync not supported, using a swap interval of %d\n", _options.swapInterval);
+    glfwSwapInterval(_adaptive ? -_options.swapInterval : _options.swapInterval);
+}
+
+void FramePacer::wait()
+{
+    if(_period != clock::duration::zero()) {
+        TRACE_SCOPE("frame limiter");
+        _deadline += _period;
+
+        // Too far behind to catch up, start over from now
+        auto now = clock::now();
+        if(now > _deadline + _period)
+            _deadline = now;
+
+        auto wake = _deadline - _spinMargin;
+        if(now < wake) {
+            std::this_thread::sleep_until(wake);
+            auto late = clock::now() - wake;
+            _spinMargin = std::min<clock::duration>(std::max<clock::duration>((_spinMargin * 7 + late * 2) / 8,
+                                                                              MIN_SPIN_MARGIN),
+                                                    MAX_SPIN_MARGIN);
+        }
+        while(clock::now() < _deadline)
+            std::this_thread::yield();
+    }
+
+    auto now = clock::now();
+    _frameTimes[_next] = std::chrono::duration<double, std::milli>(now - _lastFrame).count();
+    _next = (_next + 1) % HISTORY;
+    _count = std::min(_count + 1, HISTORY);
+    _lastFrame = now;
+}
+
+double FramePacer::meanMs() const
+{
+    if(!_count)
+        return 0.0;
+    double sum = 0.0;
+    for(int i = 0; i < _count; i++)
+        sum += _frameTimes[i];
+    return sum / _count;
+}
+
+double FramePacer::varianceMs() const
+{
+    if(_count < 2)
+        return 0.0;
+    double mean = meanMs();
+    double sum = 0.0;
+    for(int i = 0; i < _count; i++)
+        sum += (_frameTimes[i] - mean) * (_frameTimes[i] - mean);
+    return sum / (_count - 1);
+}
+
+double FramePacer::stddevMs() const
+{
+    return sqrt(varianceMs());
+}
+
+std::string FramePacer::description() const
+{
+    std::string result = _options.swapInterval ? fmt::format("vsync {}", _options.swapInterval) : "no vsync";
+    if(_adaptive)
+        result += " adaptive";
+    if(_options.fpsLimit > 0.0)
+        result += fmt::format(", limit {:g} fps", _options.fpsLimit);
+    return result;
+}
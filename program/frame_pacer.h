@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+struct pacing_options {
+    int swapInterval;           /* Vblanks per swap, 0 for no vsync */
+    bool adaptive;              /* Swap late frames right away instead of waiting a vblank */
+    double fpsLimit;            /* 0 for no limit */
+};
+
+/*
+ * Frame pacing: swap interval, optional frame rate limiter and frame
+ * time statistics.
+ *
+ * wait() goes at the top of the frame, right before input is sampled, so
+ * time spent waiting doesn't add to input latency. The limiter sleeps
+ * until shortly before the deadline and spins the rest of the way; the
+ * spin margin follows how late sleeps actually wake up.
+ */
+class FramePacer {
+    public:
+        static const int HISTORY = 240;     /* Frames in the statistics */
+
+    private:
+        typedef std::chrono::steady_clock clock;
+
+        pacing_options _options;
+        bool _adaptive;                     /* Requested and supported */
+        clock::duration _period;            /* Zero without a limit */
+        clock::time_point _deadline;
+        clock::duration _spinMargin;
+        clock::time_point _lastFrame;
+        double _frameTimes[HISTORY];        /* Milliseconds, ring */
+        int _next;
+        int _count;
+
+    public:
+        FramePacer(const pacing_options& options);
+
+        // Sets the swap interval of the current context
+        void apply();
+
+        // Blocks until the next frame may start and records the frame time
+        void wait();
+
+        double meanMs() const;
+        double varianceMs() const;          /* In ms squared */
+        double stddevMs() const;
+
+        // Short summary of the settings, for the HUD
+        std::string description() const;
+};
@@ -0,0 +1,69 @@
+#include "frame_pipeline.h"
+
+#include "trace.h"
+
+FramePipeline::FramePipeline(BuildProc build):
+    _build(build),
+    _slot(0),
+    _busy(false),
+    _quit(false)
+{
+    _worker = std::thread(&FramePipeline::run, this);
+}
+
+FramePipeline::~FramePipeline()
+{
+    try {
+        wait();
+    } catch(std::exception&) {
+    }
+    _quit = true;
+    _start.signal();
+    _worker.join();
+}
+
+void FramePipeline::start(int slot)
+{
+    wait();
+    _slot = slot;
+    _busy = true;
+    _start.signal();
+}
+
+void FramePipeline::wait()
+{
+    if(!_busy)
+        return;
+    {
+        TRACE_SCOPE("wait for build");
+        _done.wait();
+    }
+    _busy = false;
+    if(_error) {
+        std::exception_ptr error = _error;
+        _error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+bool FramePipeline::busy() const
+{
+    return _busy;
+}
+
+void FramePipeline::run()
+{
+    TRACE_THREAD_NAME("frame build");
+    while(true) {
+        _start.wait();
+        if(_quit)
+            break;
+        try {
+            TRACE_SCOPE("build");
+            _build(_slot);
+        } catch(...) {
+            _error = std::current_exception();
+        }
+        _done.signal();
+    }
+}
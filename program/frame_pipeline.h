@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <thread>
+
+#include "semaphore.h"
+
+/*
+ * Second stage of the frame loop: a worker thread building the next frame
+ * while the render thread submits the current one.
+ *
+ * start() hands a slot over to the worker and wait() takes it back. The
+ * slot number is the only thing passed, the frame data itself is double
+ * buffered by whoever builds it. An exception thrown by the build comes
+ * out of wait().
+ */
+class FramePipeline {
+    public:
+        typedef std::function<void(int slot)> BuildProc;
+
+    private:
+        BuildProc _build;
+        Semaphore _start;
+        Semaphore _done;
+        int _slot;                      /* Published by _start */
+        bool _busy;                     /* Render thread only */
+        std::atomic<bool> _quit;
+        std::exception_ptr _error;      /* Published by _done */
+        std::thread _worker;
+
+    public:
+        FramePipeline(BuildProc build);
+        ~FramePipeline();
+
+        FramePipeline(const FramePipeline&) = delete;
+        FramePipeline& operator=(const FramePipeline&) = delete;
+
+        void start(int slot);
+        void wait();                    /* Returns right away when idle */
+        bool busy() const;
+
+    private:
+        void run();
+};
@@ -0,0 +1,136 @@
+#include "headless.h"
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include <fmt/printf.h>
+#include <glm/glm.hpp>
+
+#include "benchmark.h"
+#include "camera_path.h"
+#include "context.h"
+#include "image.h"
+#include "input.h"
+#include "job_system.h"
+#include "offscreen.h"
+#include "profiler.h"
+#include "trace.h"
+#include "plugin_manager.h"
+#include "shader.h"
+
+static const float FRAME_TIME = 1.0f / 60.0f;
+
+// Deterministic orbit around the middle of the scene
+static Camera orbitCamera(float ticks)
+{
+    const glm::vec3 target(0.0f, 0.0f, -6.0f);
+    const float radius = 12.0f;
+    const float height = 3.0f;
+
+    float angle = ticks * 0.5f;
+    glm::vec3 position = target + glm::vec3(radius * cosf(angle), height, radius * sinf(angle));
+    glm::vec3 dir = glm::normalize(target - position);
+
+    float yaw = glm::degrees(atan2f(dir.z, dir.x));
+    float pitch = glm::degrees(asinf(dir.y));
+    return Camera(position, glm::vec3(0.0f, 1.0f, 0.0f), yaw, pitch);
+}
+
+int runHeadless(const headless_options& options, PluginManager& plugins, context& ctx)
+{
+    ctx.windowWidth = options.width;
+    ctx.windowHeight = options.height;
+
+    CameraPath path;
+    if(!options.cameraPath.empty())
+        path.load(options.cameraPath);
+
+    // Replayed on the headless clock, so every run sees the same input at the same step
+    Input input;
+    if(!options.input.empty()) {
+        input.loadReplay(options.input);
+        input.startReplay(0.0);
+    }
+
+    Offscreen target(options.width, options.height);
+    target.bind();
+
+    plugins.update(&ctx);
+    plugins.wait(&ctx);
+
+    GLuint timerQuery;
+    glGenQueries(1, &timerQuery);
+
+    FrameRecorder recorder;
+    recorder.reserve(options.frames);
+
+    auto runStart = std::chrono::steady_clock::now();
+    for(int frame = 0; frame < options.frames; frame++) {
+        TRACE_SCOPE("frame");
+        float ticks = frame * FRAME_TIME;
+        if(!options.input.empty()) {
+            input.poll(ticks);
+            input.step(ctx.camera, ticks);
+            input.look(ctx.camera);
+        } else if(path.empty()) {
+            ctx.camera = orbitCamera(ticks);
+        } else {
+            ctx.camera = path.sample(path.duration() > 0.0f ? fmodf(ticks, path.duration()) : 0.0f);
+        }
+        JobSystem::instance().runMainThreadJobs();
+
+        // One simulation step per frame, drawn as is
+        plugins.step(FRAME_TIME, &ctx);
+        ctx.alpha = 1.0f;
+        ctx.stats = {};
+        Shader::resetUniformUpdates();
+        Profiler::instance().beginFrame();
+
+        auto start = std::chrono::steady_clock::now();
+        glBeginQuery(GL_TIME_ELAPSED, timerQuery);
+        glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+        plugins.draw(ticks, &ctx);
+        ctx.stats.uniformUpdates += Shader::uniformUpdates();
+        glEndQuery(GL_TIME_ELAPSED);
+        Profiler::instance().endFrame();
+        auto submitted = std::chrono::steady_clock::now();
+        glFinish();
+        auto end = std::chrono::steady_clock::now();
+
+        GLuint64 gpuTime = 0;
+        glGetQueryObjectui64v(timerQuery, GL_QUERY_RESULT, &gpuTime);
+
+        frame_sample sample;
+        sample.frameMs = std::chrono::duration<double, std::milli>(end - start).count();
+        sample.cpuMs = std::chrono::duration<double, std::milli>(submitted - start).count();
+        sample.gpuMs = gpuTime / 1e6;
+        sample.stats = ctx.stats;
+        recorder.add(sample);
+    }
+    double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+
+    glDeleteQueries(1, &timerQuery);
+
+    fmt::printf("headless: %d frames at %dx%d in %.3f s (%.1f fps)\n",
+                options.frames, options.width, options.height,
+                total, total > 0.0 ? options.frames / total : 0.0);
+    recorder.printSummary();
+    if(Profiler::instance().enabled())
+        fmt::printf("%s", Profiler::instance().report());
+
+    if(!options.json.empty()) {
+        recorder.writeJson(options.json,
+                           options.cameraPath.empty() ? "orbit" : options.cameraPath,
+                           options.width, options.height);
+        fmt::printf("  wrote %s\n", options.json);
+    }
+
+    if(!options.output.empty()) {
+        std::vector<unsigned char> pixels = target.readPixels();
+        writePng(options.output, pixels.data(), target.width(), target.height(), 4, true);
+        fmt::printf("  wrote %s\n", options.output);
+    }
+
+    target.unbind();
+    return 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+struct context;
+class PluginManager;
+
+struct headless_options {
+    int frames;
+    int width;
+    int height;
+    std::string output;         /* PNG of the last frame, empty for none */
+    std::string cameraPath;     /* Recorded path to replay, empty for the default orbit */
+    std::string json;           /* Benchmark results, empty for none */
+    std::string input;          /* Recorded input to replay from the initial camera, empty for none */
+    int drawBench;              /* Draws per frame for runDrawBench, 0 to render the scene */
+};
+
+/*
+ * Render a fixed number of frames into an offscreen framebuffer with a
+ * fixed 60 Hz timestep and the camera on a fixed path or driven by
+ * recorded input, then print timing stats. Frame times include a
+ * glFinish() so they cover the GPU work as well. Needs a current GL context (a hidden window is enough).
+ */
+int runHeadless(const headless_options& options, PluginManager& plugins, context& ctx);
@@ -0,0 +1,113 @@
+#include "hud.h"
+
+#include <algorithm>
+#include <ctime>
+#include <vector>
+#include <fmt/format.h>
+
+#include "asset_registry.h"
+#include "context.h"
+#include "frame_pacer.h"
+#include "plugin_manager.h"
+
+static const float GRAPH_MAX_MS = 50.0f;
+static const float GRAPH_HEIGHT = 60.0f;
+static const float BAR_WIDTH = 2.0f;
+static const float MARGIN = 8.0f;
+
+Hud::Hud(const context& ctx, bool sdf):
+    _text(make_text_context(ctx, 16.0f, sdf)),
+    _next(0),
+    _visible(true)
+{
+    std::fill(_frameTimes, _frameTimes + HISTORY, 0.0f);
+}
+
+void Hud::setVisible(bool visible)
+{
+    _visible = visible;
+}
+
+bool Hud::visible() const
+{
+    return _visible;
+}
+
+void Hud::addFrame(float milliseconds)
+{
+    _frameTimes[_next] = milliseconds;
+    _next = (_next + 1) % HISTORY;
+}
+
+void Hud::draw(const context& ctx, int fps, const PluginManager& plugins, const FramePacer& pacer)
+{
+    if(!_visible)
+        return;
+
+    const frame_stats& stats = ctx.stats;
+    float lastFrame = _frameTimes[(_next + HISTORY - 1) % HISTORY];
+
+    std::vector<std::string> lines = {
+        fmt::format("{} fps  {:.2f} ms", fps, lastFrame),
+        fmt::format("pacing       {}, stddev {:.2f} ms", pacer.description(), pacer.stddevMs()),
+        fmt::format("draw calls   {} ({} culled)", stats.drawCalls, stats.culledObjects),
+        fmt::format("uniforms     {}", stats.uniformUpdates),
+        fmt::format("binds        prog {} vao {} tex {}", stats.programBinds, stats.vaoBinds, stats.textureBinds),
+        fmt::format("textures     {:.1f} MB", ctx.textureMemory / (1024.0 * 1024.0)),
+        stats.picked ? fmt::format("picked       object {}", stats.picked - 1) : std::string("picked       none"),
+        fmt::format("assets       {} reloads, {} pending",
+                    AssetRegistry::instance().reloads(), AssetRegistry::instance().pending()),
+    };
+
+    // One line per plugin, in draw order
+    for(size_t i = 0; i < plugins.size(); i++) {
+        const SceneLoader& loader = plugins.loader(i);
+        const plugin_timing& timing = plugins.timing(i);
+        std::string status;
+        if(!loader.loadCount()) {
+            status = "not loaded";
+        } else {
+            status = fmt::format("cpu {:.2f} build {:.2f} gpu {:.2f} ms, {} reloads, last {}s ago",
+                                 timing.cpuMs, timing.buildMs, std::max(timing.gpuMs, 0.0),
+                                 loader.loadCount() - 1,
+                                 (long)(time(nullptr) - loader.loadTime()));
+        }
+        if(loader.loading())
+            status += ", loading";
+        lines.push_back(fmt::format("{:<12} {}", plugins.name(i), status));
+    }
+    const int lineCount = (int)lines.size();
+
+    float lineHeight = _text->lineHeight();
+    float panelWidth = HISTORY * BAR_WIDTH;
+    for(const auto& line : lines)
+        panelWidth = std::max(panelWidth, _text->textWidth(line));
+    float panelHeight = GRAPH_HEIGHT + MARGIN + lineCount * lineHeight;
+
+    _text->begin(ctx.windowWidth, ctx.windowHeight);
+    _text->drawRect(MARGIN / 2, MARGIN / 2, panelWidth + MARGIN, panelHeight + MARGIN, 0x000000A0);
+
+    // Frame time graph, oldest on the left, with the 60 and 30 fps marks
+    float graphBottom = MARGIN + GRAPH_HEIGHT;
+    for(int i = 0; i < HISTORY; i++) {
+        float ms = _frameTimes[(_next + i) % HISTORY];
+        float h = std::min(ms, GRAPH_MAX_MS) / GRAPH_MAX_MS * GRAPH_HEIGHT;
+        uint32_t color = ms > 33.4f ? 0xE04040FF : ms > 16.7f ? 0xE0C040FF : 0x40C040FF;
+        _text->drawRect(MARGIN + i * BAR_WIDTH, graphBottom - h, BAR_WIDTH, h, color);
+    }
+    _text->drawRect(MARGIN, graphBottom - 16.7f / GRAPH_MAX_MS * GRAPH_HEIGHT, HISTORY * BAR_WIDTH, 1.0f, 0xFFFFFF60);
+    _text->drawRect(MARGIN, graphBottom - 33.3f / GRAPH_MAX_MS * GRAPH_HEIGHT, HISTORY * BAR_WIDTH, 1.0f, 0xFFFFFF60);
+
+    float y = graphBottom + MARGIN;
+    for(const auto& line : lines) {
+        y += lineHeight;
+        _text->drawText(MARGIN, y - 3.0f, line);
+    }
+
+    // Crosshair, what the picking ray goes through
+    float cx = ctx.windowWidth * 0.5f, cy = ctx.windowHeight * 0.5f;
+    _text->drawRect(cx - 6.0f, cy - 0.5f, 12.0f, 1.0f, 0xFFFFFFC0);
+    _text->drawRect(cx - 0.5f, cy - 6.0f, 1.0f, 12.0f, 0xFFFFFFC0);
+
+    _text->draw();
+}
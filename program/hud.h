@@ -0,0 +1,33 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "text_context.h"
+
+struct context;
+class PluginManager;
+class FramePacer;
+
+// Performance overlay: frame time graph and the frame counters
+class Hud {
+    public:
+        static const int HISTORY = 120;
+
+    private:
+        std::shared_ptr<text_context> _text;
+        float _frameTimes[HISTORY];     /* Milliseconds, ring */
+        int _next;
+        bool _visible;
+
+    public:
+        Hud(const context& ctx, bool sdf = false);    /* Distance field text, see text_context */
+
+        void setVisible(bool visible);
+        bool visible() const;
+
+        void addFrame(float milliseconds);
+
+        // Everything goes out in a single draw call
+        void draw(const context& ctx, int fps, const PluginManager& plugins, const FramePacer& pacer);
+};
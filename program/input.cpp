@@ -0,0 +1,271 @@
+#include "input.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fmt/format.h>
+#include <fmt/printf.h>
+#include <GLFW/glfw3.h>
+
+#include "camera.h"
+#include "exception.h"
+
+const int Input::QUEUE_SIZE;
+const int Input::KEY_COUNT;
+
+static const struct {
+    int key;
+    CameraMovement direction;
+} KEY_BINDINGS[] = {
+    { GLFW_KEY_W, CameraMovement::FORWARD },
+    { GLFW_KEY_S, CameraMovement::BACKWARD },
+    { GLFW_KEY_A, CameraMovement::LEFT },
+    { GLFW_KEY_D, CameraMovement::RIGHT },
+    { GLFW_KEY_UP, CameraMovement::UP },
+    { GLFW_KEY_DOWN, CameraMovement::DOWN },
+};
+
+static Input* windowInput(GLFWwindow* window)
+{
+    return static_cast<Input*>(glfwGetWindowUserPointer(window));
+}
+
+static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    windowInput(window)->push(input_event{ glfwGetTime(), InputEventType::KEY, key, action, 0.0, 0.0 });
+}
+
+static void cursor_callback(GLFWwindow* window, double x, double y)
+{
+    windowInput(window)->push(input_event{ glfwGetTime(), InputEventType::MOUSE_MOVE, 0, 0, x, y });
+}
+
+static void scroll_callback(GLFWwindow* window, double x, double y)
+{
+    windowInput(window)->push(input_event{ glfwGetTime(), InputEventType::SCROLL, 0, 0, x, y });
+}
+
+Input::Input():
+    _queue(QUEUE_SIZE),
+    _time(0.0),
+    _firstMove(true),
+    _lastX(0.0),
+    _lastY(0.0),
+    _dropped(0),
+    _rawMotion(false),
+    _recording(false),
+    _recordStart(0.0),
+    _replayNext(0),
+    _replayStart(0.0)
+{
+    std::fill(_keys, _keys + KEY_COUNT, false);
+}
+
+void Input::attach(GLFWwindow* window)
+{
+    glfwSetWindowUserPointer(window, this);
+    glfwSetKeyCallback(window, key_callback);
+    glfwSetCursorPosCallback(window, cursor_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    // Unaccelerated, unscaled motion, only applies while the cursor is disabled
+#ifdef GLFW_RAW_MOUSE_MOTION
+    if(glfwRawMouseMotionSupported()) {
+        glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
+        _rawMotion = true;
+    }
+#endif
+}
+
+// Called from the GLFW callbacks, the queue is dropped from when full
+void Input::push(const input_event& event)
+{
+    if(!_queue.push(event))
+        _dropped++;
+}
+
+void Input::poll(double now)
+{
+    _pressed.clear();
+    input_event event;
+    while(_queue.pop(event)) {
+        if(event.type == InputEventType::KEY && event.action == GLFW_PRESS)
+            _pressed.push_back(event.key);
+        if(!replaying())
+            add(event);
+    }
+
+    while(_replayNext < _replay.size() && _replay[_replayNext].time + _replayStart <= now) {
+        event = _replay[_replayNext++];
+        event.time += _replayStart;
+        add(event);
+    }
+}
+
+void Input::add(const input_event& event)
+{
+    if(_recording) {
+        input_event recorded = event;
+        recorded.time -= _recordStart;
+        _recorded.push_back(recorded);
+    }
+    _events.push_back(PendingEvent{ event, false });
+}
+
+void Input::step(Camera& camera, double until)
+{
+    while(!_events.empty() && _events.front().event.time <= until) {
+        const PendingEvent& pending = _events.front();
+        double time = std::max(pending.event.time, _time);
+        move(camera, time - _time);
+        _time = time;
+
+        const input_event& event = pending.event;
+        if(event.type == InputEventType::KEY) {
+            if(event.key >= 0 && event.key < KEY_COUNT)
+                _keys[event.key] = event.action != GLFW_RELEASE;
+        } else if(!pending.looked) {
+            apply(camera, event);
+        }
+        _events.pop_front();
+    }
+
+    if(until > _time) {
+        move(camera, until - _time);
+        _time = until;
+    }
+}
+
+void Input::look(Camera& camera)
+{
+    for(auto& pending : _events) {
+        if(pending.event.type != InputEventType::KEY && !pending.looked) {
+            apply(camera, pending.event);
+            pending.looked = true;
+        }
+    }
+}
+
+void Input::move(Camera& camera, double duration)
+{
+    if(duration <= 0.0)
+        return;
+    for(const auto& binding : KEY_BINDINGS) {
+        if(_keys[binding.key])
+            camera.processKeyboard(binding.direction, (float)duration);
+    }
+}
+
+void Input::apply(Camera& camera, const input_event& event)
+{
+    if(event.type == InputEventType::SCROLL) {
+        camera.processMouseScroll(event.x, event.y);
+        return;
+    }
+
+    if(_firstMove) {
+        _lastX = event.x;
+        _lastY = event.y;
+        _firstMove = false;
+    }
+    float xoffset = event.x - _lastX;
+    float yoffset = _lastY - event.y;
+    _lastX = event.x;
+    _lastY = event.y;
+    camera.processMouseMovement(xoffset, yoffset);
+}
+
+bool Input::pressed(int key) const
+{
+    return std::find(_pressed.begin(), _pressed.end(), key) != _pressed.end();
+}
+
+void Input::startRecording(double now)
+{
+    _recording = true;
+    _recordStart = now;
+    _recorded.clear();
+}
+
+void Input::saveRecording(const std::string& filename) const
+{
+    FILE* f = fopen(filename.c_str(), "w");
+    if(!f)
+        throw Exception(fmt::format("Cannot write input recording \"{}\"", filename));
+
+    fprintf(f, "# time key <key> <action> | time move <x> <y> | time scroll <x> <y>\n");
+    for(const auto& event : _recorded) {
+        if(event.type == InputEventType::KEY)
+            fprintf(f, "%.6f key %d %d\n", event.time, event.key, event.action);
+        else
+            fprintf(f, "%.6f %s %.3f %.3f\n", event.time,
+                    event.type == InputEventType::MOUSE_MOVE ? "move" : "scroll",
+                    event.x, event.y);
+    }
+    fclose(f);
+}
+
+size_t Input::recordedEvents() const
+{
+    return _recorded.size();
+}
+
+void Input::loadReplay(const std::string& filename)
+{
+    FILE* f = fopen(filename.c_str(), "r");
+    if(!f)
+        throw Exception(fmt::format("Cannot open input recording \"{}\"", filename));
+
+    _replay.clear();
+    char line[256];
+    int lineNo = 0;
+    while(fgets(line, sizeof(line), f)) {
+        lineNo++;
+        const char* p = line;
+        while(*p == ' ' || *p == '\t')
+            p++;
+        if(*p == '#' || *p == '\n' || *p == '\r' || *p == 0)
+            continue;
+
+        input_event event = {};
+        char type[16];
+        bool valid = false;
+        if(sscanf(p, "%lf %15s", &event.time, type) == 2) {
+            if(!strcmp(type, "key")) {
+                event.type = InputEventType::KEY;
+                valid = sscanf(p, "%*f %*s %d %d", &event.key, &event.action) == 2;
+            } else if(!strcmp(type, "move") || !strcmp(type, "scroll")) {
+                event.type = !strcmp(type, "move") ? InputEventType::MOUSE_MOVE : InputEventType::SCROLL;
+                valid = sscanf(p, "%*f %*s %lf %lf", &event.x, &event.y) == 2;
+            }
+        }
+        if(!valid || (!_replay.empty() && event.time < _replay.back().time)) {
+            fclose(f);
+            throw Exception(fmt::format("{}:{}: invalid input event", filename, lineNo));
+        }
+        _replay.push_back(event);
+    }
+    fclose(f);
+}
+
+void Input::startReplay(double now)
+{
+    _replayNext = 0;
+    _replayStart = now;
+    _time = now;
+}
+
+bool Input::replaying() const
+{
+    return _replayNext < _replay.size();
+}
+
+bool Input::rawMotion() const
+{
+    return _rawMotion;
+}
+
+unsigned Input::dropped() const
+{
+    return _dropped;
+}
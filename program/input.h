@@ -0,0 +1,101 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "spsc_queue.h"
+
+struct GLFWwindow;
+class Camera;
+
+enum class InputEventType {
+    KEY, MOUSE_MOVE, SCROLL
+};
+
+struct input_event {
+    double time;                /* glfwGetTime(), or since the start in recordings */
+    InputEventType type;
+    int key;                    /* KEY: GLFW key and action */
+    int action;
+    double x, y;                /* MOUSE_MOVE: cursor position, SCROLL: offsets */
+};
+
+/*
+ * Timestamped input.
+ *
+ * The GLFW callbacks push every event into a lock-free queue that poll()
+ * drains once per frame. step() then integrates the events up to the end
+ * of a simulation step in timestamp order: movement keys count for
+ * exactly as long as they were held within the step, in the direction
+ * the camera was looking at the time. look() applies the mouse look
+ * events not integrated yet right away, so looking around doesn't wait
+ * for the next step.
+ *
+ * Input can be recorded to a file, one event per line:
+ *   time key <key> <action> | time move <x> <y> | time scroll <x> <y>
+ * and replayed instead of the live input, times relative to the start.
+ */
+class Input {
+    public:
+        static const int QUEUE_SIZE = 1024;
+        static const int KEY_COUNT = 512;       /* Above GLFW_KEY_LAST */
+
+    private:
+        struct PendingEvent {
+            input_event event;
+            bool looked;                        /* Already applied by look() */
+        };
+
+        SpscQueue<input_event> _queue;          /* Filled by the GLFW callbacks */
+        std::deque<PendingEvent> _events;       /* Polled, not integrated yet */
+        bool _keys[KEY_COUNT];                  /* Held as of _time */
+        double _time;                           /* Integrated up to */
+        std::vector<int> _pressed;              /* Live presses since the last poll() */
+        bool _firstMove;
+        double _lastX, _lastY;
+        unsigned _dropped;
+        bool _rawMotion;
+
+        bool _recording;
+        double _recordStart;
+        std::vector<input_event> _recorded;
+
+        std::vector<input_event> _replay;
+        size_t _replayNext;
+        double _replayStart;
+
+    public:
+        Input();
+
+        Input(const Input&) = delete;
+        Input& operator=(const Input&) = delete;
+
+        // Installs the key, cursor and scroll callbacks, and the window user pointer
+        void attach(GLFWwindow* window);
+        void push(const input_event& event);
+
+        // Once per frame after glfwPollEvents(), now on the glfwGetTime() clock
+        void poll(double now);
+        void step(Camera& camera, double until);
+        void look(Camera& camera);
+
+        // Key pressed since the last poll(), live input only
+        bool pressed(int key) const;
+
+        void startRecording(double now);
+        void saveRecording(const std::string& filename) const;
+        size_t recordedEvents() const;
+
+        void loadReplay(const std::string& filename);
+        void startReplay(double now);
+        bool replaying() const;
+
+        bool rawMotion() const;
+        unsigned dropped() const;
+
+    private:
+        void move(Camera& camera, double duration);
+        void apply(Camera& camera, const input_event& event);
+        void add(const input_event& event);
+};
@@ -2,6 +2,8 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <cstdio>
+#include <cstdlib>
+#include <cctype>
 #include <cmath>
 #include <memory>
 #include <fmt/format.h>
@@ -18,20 +20,30 @@
 #include "exception.h"
 #include "image.h"
 #include "system.h"
+#include "gl_ext.h"
+#include "indirect_draw.h"
+#include "job_system.h"
+#include "file_watcher.h"
+#include "fixed_timestep.h"
 
 #include "camera.h"
 #include "context.h"
 #include "scene.h"
-#include "scene_loader.h"
+#include "plugin_manager.h"
+#include "headless.h"
+#include "draw_bench.h"
+#include "camera_path.h"
+#include "profiler.h"
+#include "trace.h"
+#include "hud.h"
+#include "frame_pacer.h"
+#include "input.h"
 
 static context ctx;
+static std::shared_ptr<Hud> hud;
 
 #if 0
 #endif
-static bool firstMouse = true;
-static float lastMouseX = 0.0f;
-static float lastMouseY = 0.0f;
-
 //#define USE_EBO
 
 // Callback called when the window is resized
@@ -42,49 +54,111 @@ static void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     ctx.windowHeight = height;
 }
 
-// Process inputs
-static void processInput(GLFWwindow *window, float deltaTicks)
+struct program_options {
+    bool headless;
+    headless_options headlessOptions;
+    std::string record;         /* Camera path to record */
+    std::string recordInput;    /* Input events to record */
+    std::string replayInput;    /* Input events to replay instead of the live input */
+    std::string profile;        /* Frame profiler trace */
+    std::string trace;          /* TRACE_SCOPE trace */
+    std::string plugins;        /* Scene library directory, empty for the default */
+    bool noPipeline;            /* Build and submit frames on the render thread */
+    pacing_options pacing;
+    bool sdfText;               /* Distance field HUD text */
+};
+
+static void usage(const char* argv0)
 {
-    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, true);
-
-    if(glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        ctx.camera.processKeyboard(CameraMovement::FORWARD, deltaTicks);
-    if(glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        ctx.camera.processKeyboard(CameraMovement::BACKWARD, deltaTicks);
-    if(glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        ctx.camera.processKeyboard(CameraMovement::LEFT, deltaTicks);
-    if(glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        ctx.camera.processKeyboard(CameraMovement::RIGHT, deltaTicks);
-    if(glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
-        ctx.camera.processKeyboard(CameraMovement::UP, deltaTicks);
-    if(glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
-        ctx.camera.processKeyboard(CameraMovement::DOWN, deltaTicks);
+    fmt::printf("Usage: %s [--record path.txt] [--profile profile.json] [--trace trace.json]\n"
+                "          [--plugins dir] [--no-pipeline]\n"
+                "          [--vsync N] [--adaptive-vsync] [--fps-limit N]\n"
+                "          [--record-input input.txt] [--replay-input input.txt] [--sdf-text]\n"
+                "       %s --headless [--frames N] [--size WxH] [--output file.png]\n"
+                "                     [--benchmark path.txt] [--json results.json]\n"
+                "                     [--profile profile.json] [--trace trace.json]\n"
+                "                     [--plugins dir] [--no-pipeline]\n"
+                "                     [--replay-input input.txt]\n"
+                "       %s --draw-bench [N] [--frames N] [--size WxH]\n",
+                argv0, argv0, argv0);
 }
 
-static void mouse_callback(GLFWwindow* window, double xpos, double ypos)
+// Returns false on invalid arguments
+static bool parseArgs(int argc, char** argv, program_options& result)
 {
-    if(firstMouse) {
-        lastMouseX = xpos;
-        lastMouseY = ypos;
-        firstMouse = false;
+    headless_options& options = result.headlessOptions;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "--headless") {
+            result.headless = true;
+        } else if(arg == "--draw-bench") {
+            result.headless = true;
+            options.drawBench = 10000;
+            if(hasValue && isdigit((unsigned char)argv[i + 1][0]))
+                options.drawBench = atoi(argv[++i]);
+            if(options.drawBench <= 0)
+                return false;
+        } else if(arg == "--frames" && hasValue) {
+            options.frames = atoi(argv[++i]);
+            if(options.frames <= 0)
+                return false;
+        } else if(arg == "--size" && hasValue) {
+            if(sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 ||
+               options.width <= 0 || options.height <= 0)
+                return false;
+        } else if(arg == "--output" && hasValue) {
+            options.output = argv[++i];
+        } else if(arg == "--benchmark" && hasValue) {
+            options.cameraPath = argv[++i];
+        } else if(arg == "--json" && hasValue) {
+            options.json = argv[++i];
+        } else if(arg == "--record" && hasValue) {
+            result.record = argv[++i];
+        } else if(arg == "--record-input" && hasValue) {
+            result.recordInput = argv[++i];
+        } else if(arg == "--replay-input" && hasValue) {
+            result.replayInput = argv[++i];
+            options.input = result.replayInput;
+        } else if(arg == "--profile" && hasValue) {
+            result.profile = argv[++i];
+        } else if(arg == "--trace" && hasValue) {
+            result.trace = argv[++i];
+        } else if(arg == "--plugins" && hasValue) {
+            result.plugins = argv[++i];
+        } else if(arg == "--sdf-text") {
+            result.sdfText = true;
+        } else if(arg == "--no-pipeline") {
+            result.noPipeline = true;
+        } else if(arg == "--vsync" && hasValue) {
+            result.pacing.swapInterval = atoi(argv[++i]);
+            if(result.pacing.swapInterval < 0)
+                return false;
+        } else if(arg == "--adaptive-vsync") {
+            result.pacing.adaptive = true;
+        } else if(arg == "--fps-limit" && hasValue) {
+            result.pacing.fpsLimit = atof(argv[++i]);
+            if(result.pacing.fpsLimit <= 0.0)
+                return false;
+        } else if(arg.compare(0, 5, "-psn_") == 0) {
+            // Process serial number passed by the macOS Finder
+        } else {
+            return false;
+        }
     }
-
-    float xoffset = xpos - lastMouseX;
-    float yoffset = lastMouseY - ypos;
-    lastMouseX = xpos;
-    lastMouseY = ypos;
-
-    ctx.camera.processMouseMovement(xoffset, yoffset);
-}
-
-static void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
-{
-    ctx.camera.processMouseScroll(xoffset, yoffset);
+    return true;
 }
 
 int main(int argc, char** argv)
 {
+    TRACE_THREAD_NAME("main");
+
+    program_options options = { false, { 300, 1280, 720, "", "", "", "", 0 }, "", "", "", "", "", "", false, { 1, false, 0.0 }, false };
+    if(!parseArgs(argc, argv, options)) {
+        usage(argv[0]);
+        return 1;
+    }
+
     // Get resource path
     auto exePath = sys::exepath(argc, argv);
     auto appPath = sys::dirname(exePath);
@@ -94,24 +168,38 @@ int main(int argc, char** argv)
     }
     fmt::printf("appPath: %s\n", appPath);
 
+    // Generated files go next to the executable, out of the watched resources
+    ctx.cacheDir = appPath;
+
     // Init glfw
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if(options.headless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    static const int glVersions[][2] = { {3, 3} };
+#else
+    // Prefer a context recent enough for multi-draw indirect
+    static const int glVersions[][2] = { {4, 6}, {4, 3}, {3, 3} };
 #endif
 
     // Create glfw window
     ctx.windowWidth = 800;
     ctx.windowHeight = 600;
-    GLFWwindow* window = glfwCreateWindow(ctx.windowWidth, 
-                                          ctx.windowHeight, 
-                                          "gltut", 
-                                          NULL, 
-                                          NULL);
+    GLFWwindow* window = NULL;
+    for(const auto& version : glVersions) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, version[0]);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, version[1]);
+        window = glfwCreateWindow(ctx.windowWidth, 
+                                  ctx.windowHeight, 
+                                  "gltut", 
+                                  NULL, 
+                                  NULL);
+        if(window)
+            break;
+    }
     if (window == NULL) {
         std::cout << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -123,7 +211,60 @@ int main(int argc, char** argv)
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
-    }    
+    }
+    glext::load((GLADloadproc)glfwGetProcAddress);
+    fmt::printf("OpenGL %d.%d, multi-draw indirect: %s\n",
+                GLVersion.major, GLVersion.minor,
+                IndirectBatch::supported() ? "yes" : "no");    
+
+    // Worker threads for the whole program, this one being the main thread
+    JobSystem& jobs = JobSystem::instance();
+    fmt::printf("Job system: %d threads\n", jobs.threadCount());
+
+    Profiler& profiler = Profiler::instance();
+    profiler.setEnabled(!options.profile.empty());
+
+    // Load the scene libraries
+    std::string pluginDir = options.plugins;
+    if(pluginDir.empty()) {
+#ifdef __APPLE__
+        pluginDir = fmt::sprintf("%s/../../../../scene", appPath);
+#else
+        pluginDir = fmt::sprintf("%s/../scene", appPath);
+#endif
+    }
+    fmt::printf("pluginDir: %s\n", pluginDir);
+    FileWatcher watcher;
+    PluginManager plugins(pluginDir, watcher);
+    plugins.setPipelined(!options.noPipeline);
+    watcher.watch(ctx.resDir);
+
+    // Initial camera pos
+    ctx.camera = Camera(1.14f, 0.89f, 1.85f,
+                        0.0f, 1.0f, 0.0f,
+                        239.90f, -24.0f);
+
+    if(options.headless) {
+        int ret;
+        try {
+            if(options.headlessOptions.drawBench)
+                ret = runDrawBench(options.headlessOptions, ctx);
+            else
+                ret = runHeadless(options.headlessOptions, plugins, ctx);
+        } catch(std::exception& e) {
+            std::cout << e.what() << std::endl;
+            ret = 1;
+        }
+        if(profiler.enabled()) {
+            profiler.writeChromeTrace(options.profile);
+            profiler.release();
+        }
+        if(!options.trace.empty())
+            TRACE_FLUSH(options.trace);
+        plugins.release();
+        glfwTerminate();
+        return ret;
+    }
 
     // Set viewport
     glViewport(0, 0, 
@@ -132,20 +273,27 @@ int main(int argc, char** argv)
     // tell it to call a callback when window is resized    
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-    // Add some input callbacks
+    // Timestamped input, raw mouse motion needs the cursor disabled
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
+    Input input;
+    input.attach(window);
+    fmt::printf("Raw mouse motion: %s\n", input.rawMotion() ? "yes" : "no");
+    if(!options.replayInput.empty()) {
+        input.loadReplay(options.replayInput);
+        input.startReplay(glfwGetTime());
+    }
+    if(!options.recordInput.empty())
+        input.startRecording(glfwGetTime());
 
-    // Load scene
-    std::string sceneFile = fmt::sprintf("%s/../../../../scene/libscene.dylib", appPath);
-    fmt::printf("sceneFile: %s\n", sceneFile);
-    SceneLoader sceneLoader(sceneFile);
+    FramePacer pacer(options.pacing);
+    pacer.apply();
 
-    // Initial camera pos
-    ctx.camera = Camera(1.14f, 0.89f, 1.85f,
-                        0.0f, 1.0f, 0.0f,
-                        239.90f, -24.0f);
+    // Performance overlay, F1 toggles it
+    hud = std::make_shared<Hud>(ctx, options.sdfText);
+
+    // Start with every plugin loaded, reloads happen in the background afterwards
+    plugins.update(&ctx);
+    plugins.wait(&ctx);
 
     // Event loop
     long frames = 0;
@@ -155,15 +303,67 @@ int main(int argc, char** argv)
     float deltaTicks = 0.0f;	// Time between current frame and last frame
     float lastTicks = 0.0f;     // Time of last frame
 
+    CameraPath recordedPath;
+    float recordStart = glfwGetTime();
+
+    // Only the camera position is simulated, Input::look applies mouse look right away
+    FixedTimestep timestep;
+    glm::vec3 cameraPosition = ctx.camera.position();
+    glm::vec3 previousCameraPosition = cameraPosition;
+
     while(!glfwWindowShouldClose(window)) {
-        float ticks = glfwGetTime();
+        TRACE_SCOPE("frame");
+
+        // Input is sampled after pacing, as close to drawing as possible
+        pacer.wait();
+        glfwPollEvents();
+        double now = glfwGetTime();
+        input.poll(now);
+        if(input.pressed(GLFW_KEY_ESCAPE))
+            glfwSetWindowShouldClose(window, true);
+        if(input.pressed(GLFW_KEY_F1))
+            hud->setVisible(!hud->visible());
+
+        float ticks = now;
         deltaTicks = ticks - lastTicks;
         lastTicks = ticks;
 
-        processInput(window, deltaTicks);
+        // Only drains the file watcher queue unless something changed. Up
+        // to here the next frame was being built in the background.
+        plugins.update(&ctx);
+        jobs.runMainThreadJobs();
+
+        {
+            TRACE_SCOPE("simulate");
+            ctx.camera.setPosition(cameraPosition);
+            timestep.advance(deltaTicks);
+            while(timestep.step()) {
+                previousCameraPosition = ctx.camera.position();
+                input.step(ctx.camera, now - timestep.lag());
+                plugins.step(timestep.dt(), &ctx);
+            }
+            input.look(ctx.camera);
+            cameraPosition = ctx.camera.position();
+            ctx.alpha = timestep.alpha();
+            ctx.camera.setPosition(glm::mix(previousCameraPosition, cameraPosition, ctx.alpha));
+        }
+
+        ctx.stats = {};
+        Shader::resetUniformUpdates();
+        profiler.beginFrame();
+
+        if(!options.record.empty())
+            recordedPath.add(ticks - recordStart, ctx.camera);
 
-        glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
-        sceneLoader.draw(ticks, &ctx);
+        {
+            TRACE_SCOPE("draw");
+            glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+            plugins.draw(ticks, &ctx);
+            ctx.stats.uniformUpdates += Shader::uniformUpdates();
+        }
+
+        hud->addFrame(deltaTicks * 1000.0f);
+        hud->draw(ctx, fps, plugins, pacer);
 
         frames++;
         if(frames > 30 && ticks - lastFrames > 0.0f) {
@@ -171,14 +371,46 @@ int main(int argc, char** argv)
             frames = 0;
             lastFrames = ticks;
 
-            sceneLoader.update(&ctx);
+            glfwSetWindowTitle(window, fmt::format("gltut - {} fps, {} draw calls",
+                                                   fps, ctx.stats.drawCalls).c_str());
         }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        profiler.endFrame();
+
+        {
+            TRACE_SCOPE("swap");
+            glfwSwapBuffers(window);
+        }
+    }
+
+    fmt::printf("Frame time: mean %.3f ms, stddev %.3f ms (%s)\n",
+                pacer.meanMs(), pacer.stddevMs(), pacer.description());
+
+    if(profiler.enabled()) {
+        fmt::printf("%s", profiler.report());
+        profiler.writeChromeTrace(options.profile);
+        fmt::printf("Wrote profile to %s\n", options.profile);
+        profiler.release();
+    }
+
+    if(!options.record.empty()) {
+        recordedPath.save(options.record);
+        fmt::printf("Recorded %d camera keyframes to %s\n", (int)recordedPath.size(), options.record);
+    }
+
+    if(!options.recordInput.empty()) {
+        input.saveRecording(options.recordInput);
+        fmt::printf("Recorded %d input events to %s\n", (int)input.recordedEvents(), options.recordInput);
+    }
+
+    if(!options.trace.empty()) {
+        TRACE_FLUSH(options.trace);
+        fmt::printf("Wrote trace to %s\n", options.trace);
     }
 
     // Cleanup
+    hud.reset();
+    plugins.release();
     glfwTerminate();
   
     return 0;
@@ -0,0 +1,75 @@
+#include "offscreen.h"
+
+#include <fmt/format.h>
+
+#include "exception.h"
+
+Offscreen::Offscreen(int width, int height):
+    _fbo(0),
+    _color(0),
+    _depth(0),
+    _width(width),
+    _height(height)
+{
+    glGenFramebuffers(1, &_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+
+    glGenRenderbuffers(1, &_color);
+    glBindRenderbuffer(GL_RENDERBUFFER, _color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _color);
+
+    glGenRenderbuffers(1, &_depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, _depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _depth);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if(status != GL_FRAMEBUFFER_COMPLETE)
+        throw Exception(fmt::format("Offscreen framebuffer {}x{} incomplete: 0x{:X}", width, height, status));
+}
+
+Offscreen::~Offscreen()
+{
+    glDeleteFramebuffers(1, &_fbo);
+    glDeleteRenderbuffers(1, &_color);
+    glDeleteRenderbuffers(1, &_depth);
+}
+
+void Offscreen::bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+    glViewport(0, 0, _width, _height);
+}
+
+void Offscreen::unbind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+std::vector<unsigned char> Offscreen::readPixels() const
+{
+    std::vector<unsigned char> pixels((size_t)_width * _height * 4);
+
+    GLint previous = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, _fbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, previous);
+
+    return pixels;
+}
+
+int Offscreen::width() const
+{
+    return _width;
+}
+
+int Offscreen::height() const
+{
+    return _height;
+}
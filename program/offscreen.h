@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+#include <glad/glad.h>
+
+// RGBA8 + depth framebuffer object to render into without a visible window
+class Offscreen {
+    private:
+        GLuint _fbo;
+        GLuint _color;
+        GLuint _depth;
+        int _width;
+        int _height;
+
+    public:
+        Offscreen(int width, int height);
+        ~Offscreen();
+
+        Offscreen(const Offscreen&) = delete;
+        Offscreen& operator=(const Offscreen&) = delete;
+
+        void bind();
+        void unbind();
+
+        // RGBA pixels, bottom row first
+        std::vector<unsigned char> readPixels() const;
+
+        int width() const;
+        int height() const;
+};
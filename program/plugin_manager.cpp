@@ -0,0 +1,249 @@
+#include "plugin_manager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <dirent.h>
+#include <fmt/format.h>
+#include <fmt/printf.h>
+
+#include "asset_registry.h"
+#include "file_watcher.h"
+#include "profiler.h"
+#include "shader.h"
+#include "trace.h"
+
+#ifdef __APPLE__
+static const char LIBRARY_SUFFIX[] = ".dylib";
+#else
+static const char LIBRARY_SUFFIX[] = ".so";
+#endif
+
+PluginManager::PluginManager(const std::string& directory, FileWatcher& watcher):
+    _directory(directory),
+    _watcher(watcher),
+    _frame(0),
+    _slot(0),
+    _ahead(false),
+    _aheadGeneration(0)
+{
+    _watcher.watch(_directory);
+    scan();
+    setPipelined(true);
+}
+
+void PluginManager::setPipelined(bool pipelined)
+{
+    sync();
+    if(pipelined && !_pipeline)
+        _pipeline.reset(new FramePipeline([this](int slot) { build(slot); }));
+    else if(!pipelined)
+        _pipeline.reset();
+    _slot = 0;
+    _ahead = false;
+}
+
+bool PluginManager::pipelined() const
+{
+    return _pipeline != nullptr;
+}
+
+void PluginManager::sync()
+{
+    if(_pipeline)
+        _pipeline->wait();
+}
+
+// Changes whenever a plugin or an asset it may have used in a frame is replaced
+uint64_t PluginManager::generation() const
+{
+    uint64_t result = AssetRegistry::instance().reloads() + Shader::programGeneration();
+    for(const auto& plugin : _plugins)
+        result += plugin->loader->loadCount();
+    return result + _plugins.size();
+}
+
+bool PluginManager::isPlugin(const std::string& path)
+{
+    size_t suffix = sizeof(LIBRARY_SUFFIX) - 1;
+    return path.size() > suffix && path.compare(path.size() - suffix, suffix, LIBRARY_SUFFIX) == 0;
+}
+
+void PluginManager::scan()
+{
+    DIR* dir = opendir(_directory.c_str());
+    if(!dir) {
+        fmt::printf("Cannot open plugin directory \"%s\"\n", _directory);
+        return;
+    }
+    while(dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if(isPlugin(name))
+            add(fmt::format("{}/{}", _directory, name));
+    }
+    closedir(dir);
+}
+
+// Keeps the plugins sorted by file name, which is the draw order
+void PluginManager::add(const std::string& path)
+{
+    std::unique_ptr<Plugin> plugin(new Plugin);
+    plugin->name = path.substr(path.rfind('/') + 1);
+    plugin->loader.reset(new SceneLoader(path));
+    glGenQueries(LATENCY * 2, &plugin->queries[0][0]);
+    std::fill(plugin->pending, plugin->pending + LATENCY, false);
+    std::fill(plugin->buildMs, plugin->buildMs + SCENE_FRAME_SLOTS, 0.0);
+    plugin->timing = plugin_timing{ 0.0, 0.0, -1.0 };
+
+    auto position = std::lower_bound(_plugins.begin(), _plugins.end(), plugin,
+                                     [](const std::unique_ptr<Plugin>& a, const std::unique_ptr<Plugin>& b) {
+                                         return a->name < b->name;
+                                     });
+    _plugins.insert(position, std::move(plugin));
+}
+
+void PluginManager::update(context* ctx)
+{
+    TRACE_SCOPE("PluginManager::update");
+    sync();
+
+    // A plugin changing reloads that plugin, other files only the assets built from them
+    AssetRegistry& assets = AssetRegistry::instance();
+    file_event event;
+    while(_watcher.poll(event)) {
+        if(isPlugin(event.path) && event.path.compare(0, _directory.size(), _directory) == 0) {
+            auto plugin = std::find_if(_plugins.begin(), _plugins.end(),
+                                       [&event](const std::unique_ptr<Plugin>& p) {
+                                           return p->loader->filename() == event.path;
+                                       });
+            if(plugin != _plugins.end())
+                (*plugin)->loader->reload();
+            else
+                add(event.path);
+        } else if(assets.changed(event.path)) {
+            fmt::printf("Changed: %s\n", event.path);
+        }
+    }
+    assets.update();
+
+    for(auto& plugin : _plugins)
+        plugin->loader->update(ctx);
+}
+
+void PluginManager::wait(context* ctx)
+{
+    sync();
+    for(auto& plugin : _plugins)
+        plugin->loader->wait(ctx);
+}
+
+void PluginManager::step(float dt, context* ctx)
+{
+    TRACE_SCOPE("PluginManager::step");
+    sync();
+    for(auto& plugin : _plugins)
+        plugin->loader->step(dt, ctx);
+}
+
+void PluginManager::draw(float ticks, context* ctx)
+{
+    frame_input input = { ticks, ctx->alpha, ctx->windowWidth, ctx->windowHeight, ctx->camera };
+    sync();
+
+    // Built ahead last frame unless something changed since
+    uint64_t generation = this->generation();
+    if(!_pipeline || !_ahead || _aheadGeneration != generation) {
+        _inputs[_slot] = input;
+        build(_slot);
+    }
+
+    int slot = _slot;
+    if(_pipeline) {
+        _slot = (_slot + 1) % SCENE_FRAME_SLOTS;
+        _inputs[_slot] = input;
+        _pipeline->start(_slot);
+        _ahead = true;
+        _aheadGeneration = generation;
+    }
+    submit(slot, ticks, ctx);
+}
+
+// Runs on the pipeline thread unless called from draw()
+void PluginManager::build(int slot)
+{
+    for(auto& plugin : _plugins) {
+        if(!plugin->loader->loaded() || !plugin->loader->pipelined())
+            continue;
+        TRACE_SCOPE(plugin->name.c_str());
+        auto start = std::chrono::steady_clock::now();
+        plugin->loader->build(&_inputs[slot], slot);
+        plugin->buildMs[slot] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+void PluginManager::submit(int slot, float ticks, context* ctx)
+{
+    int query = (int)(_frame % LATENCY);
+    for(auto& plugin : _plugins) {
+        if(!plugin->loader->loaded())
+            continue;
+
+        // Results from LATENCY frames ago, skipped rather than waited on
+        GLuint* queries = plugin->queries[query];
+        if(plugin->pending[query]) {
+            GLint available = 0;
+            glGetQueryObjectiv(queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if(available) {
+                GLuint64 start, end;
+                glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &start);
+                glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+                plugin->timing.gpuMs = (end - start) / 1e6;
+            }
+        }
+
+        glQueryCounter(queries[0], GL_TIMESTAMP);
+        auto start = std::chrono::steady_clock::now();
+        {
+            ProfileScope scope(plugin->name.c_str(), true);
+            if(plugin->loader->pipelined()) {
+                plugin->loader->submit(ctx, slot);
+                plugin->timing.buildMs = plugin->buildMs[slot];
+            } else {
+                plugin->loader->draw(ticks, ctx);
+                plugin->timing.buildMs = 0.0;
+            }
+        }
+        plugin->timing.cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        glQueryCounter(queries[1], GL_TIMESTAMP);
+        plugin->pending[query] = true;
+    }
+    _frame++;
+}
+
+size_t PluginManager::size() const
+{
+    return _plugins.size();
+}
+
+const std::string& PluginManager::name(size_t index) const
+{
+    return _plugins[index]->name;
+}
+
+const SceneLoader& PluginManager::loader(size_t index) const
+{
+    return *_plugins[index]->loader;
+}
+
+const plugin_timing& PluginManager::timing(size_t index) const
+{
+    return _plugins[index]->timing;
+}
+
+void PluginManager::release()
+{
+    setPipelined(false);
+    for(auto& plugin : _plugins) {
+        glDeleteQueries(LATENCY * 2, &plugin->queries[0][0]);
+        std::fill(&plugin->queries[0][0], &plugin->queries[0][0] + LATENCY * 2, 0);
+    }
+}
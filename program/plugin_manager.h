@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+#include "context.h"
+#include "frame_pipeline.h"
+#include "scene_loader.h"
+
+class FileWatcher;
+
+struct plugin_timing {
+    double cpuMs;
+    double buildMs;             /* Of the frame submitted, mostly on the pipeline thread */
+    double gpuMs;               /* From LATENCY frames ago, negative until known */
+};
+
+/*
+ * Scene libraries loaded side by side.
+ *
+ * Every shared library in the plugin directory gets its own SceneLoader,
+ * so each one is reloaded on its own. Libraries showing up in the
+ * directory later are loaded too. Plugins draw into the same frame in
+ * file name order. Each draw is timed on the CPU and, with timestamp
+ * queries read back LATENCY frames later, on the GPU.
+ *
+ * Plugins implementing build/submit are pipelined: while a frame is
+ * submitted, the next one is built on a FramePipeline thread from the
+ * same frame_input, so what is drawn lags input by one frame. Anything
+ * changing plugins or assets waits for that build first (see sync()),
+ * and a frame built before such a change is built again before submit.
+ *
+ * The manager drains the file watcher: changes to anything other than a
+ * plugin go to the AssetRegistry.
+ */
+class PluginManager {
+    public:
+        static const int LATENCY = 4;
+
+    private:
+        struct Plugin {
+            std::string name;                   /* File name, also the profiler scope */
+            std::unique_ptr<SceneLoader> loader;
+            GLuint queries[LATENCY][2];
+            bool pending[LATENCY];
+            double buildMs[SCENE_FRAME_SLOTS];  /* Written by whoever builds the slot */
+            plugin_timing timing;
+        };
+
+        std::string _directory;
+        FileWatcher& _watcher;
+        std::vector<std::unique_ptr<Plugin>> _plugins;
+        uint64_t _frame;
+
+        std::unique_ptr<FramePipeline> _pipeline;      /* Null when not pipelining */
+        frame_input _inputs[SCENE_FRAME_SLOTS];
+        int _slot;                                      /* Next to submit */
+        bool _ahead;                                    /* _slot already built or being built */
+        uint64_t _aheadGeneration;
+
+    public:
+        PluginManager(const std::string& directory, FileWatcher& watcher);
+
+        PluginManager(const PluginManager&) = delete;
+        PluginManager& operator=(const PluginManager&) = delete;
+
+        void setPipelined(bool pipelined);
+        bool pipelined() const;
+
+        // Waits for the frame being built ahead, done by every other call
+        void sync();
+
+        void update(context* ctx);
+        void wait(context* ctx);                /* Finishes the loads in progress */
+        void step(float dt, context* ctx);     /* Fixed simulation step, in draw order */
+        void draw(float ticks, context* ctx);
+
+        size_t size() const;
+        const std::string& name(size_t index) const;
+        const SceneLoader& loader(size_t index) const;
+        const plugin_timing& timing(size_t index) const;
+
+        // Release the GL queries, needs the context to be current
+        void release();
+
+    private:
+        void build(int slot);
+        void submit(int slot, float ticks, context* ctx);
+        uint64_t generation() const;
+        void scan();
+        void add(const std::string& path);
+        static bool isPlugin(const std::string& path);
+};
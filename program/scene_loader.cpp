@@ -1,76 +1,224 @@
 #include "scene_loader.h"
 
+#include <chrono>
 #include <dlfcn.h>
-#include <sys/stat.h>
+#include <unistd.h>
 
+#include <fmt/format.h>
 #include <fmt/printf.h>
 
 #include "exception.h"
 #include "scene.h"
+#include "scene_state.h"
+#include "system.h"
+#include "trace.h"
 
 SceneLoader::SceneLoader(std::string filename):
     _filename(filename),
-    _timestamp{},
-    _handle(nullptr),
-    _scene{}
+    _current{},
+    _reloadRequested(true),
+    _reloadAgain(false),
+    _loadCount(0),
+    _attempts(0),
+    _loadTime(0)
 {
-
 }
 
 SceneLoader::~SceneLoader()
 {
-    releaseLibrary(nullptr);
+    if(_loading.valid()) {
+        try {
+            auto library = _loading.get();
+            closeLibrary(*library, nullptr);
+        } catch(std::exception&) {
+        }
+    }
+    closeLibrary(_current, nullptr);
+}
+
+void SceneLoader::step(float dt, context* ctx)
+{
+    if(_current.sceneObj.update)
+        _current.sceneObj.update(dt, ctx);
 }
 
 void SceneLoader::draw(float ticks, context* ctx)
 {
-    if(_scene.draw)
-        _scene.draw(ticks, ctx);
+    if(_current.sceneObj.draw)
+        _current.sceneObj.draw(ticks, ctx);
+}
+
+bool SceneLoader::pipelined() const
+{
+    return _current.sceneObj.build && _current.sceneObj.submit;
+}
+
+void SceneLoader::build(const frame_input* input, int slot)
+{
+    _current.sceneObj.build(input, slot);
+}
+
+void SceneLoader::submit(context* ctx, int slot)
+{
+    _current.sceneObj.submit(ctx, slot);
+}
+
+void SceneLoader::reload()
+{
+    _reloadRequested = true;
 }
 
 void SceneLoader::update(context* ctx)
 {
-    // Check if should reload scene
-    struct stat st;
-    int ret = stat(_filename.c_str(), &st);
-    if(ret != -1) {
-        if(st.st_mtimespec.tv_sec != _timestamp.tv_sec || 
-           st.st_mtimespec.tv_nsec != _timestamp.tv_nsec) {
-            releaseLibrary(ctx);
-            openLibrary(ctx);
+    TRACE_SCOPE("SceneLoader::update");
+    if(_reloadRequested) {
+        if(_loading.valid())
+            _reloadAgain = true;
+        else
+            startLoad(ctx);
+        _reloadRequested = false;
+    }
+
+    if(_loading.valid() && _loading.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        finishLoad(ctx);
+}
+
+void SceneLoader::wait(context* ctx)
+{
+    update(ctx);
+    if(_loading.valid()) {
+        _loading.wait();
+        finishLoad(ctx);
+    }
+}
+
+void SceneLoader::startLoad(context* ctx)
+{
+    unsigned attempt = ++_attempts;
+    const context* constCtx = ctx;
+    _loading = std::async(std::launch::async, [this, constCtx, attempt]() {
+        TRACE_THREAD_NAME("scene loader");
+        return openLibrary(constCtx, attempt);
+    });
+    _reloadAgain = false;
+}
+
+// On the render thread, between frames
+void SceneLoader::finishLoad(context* ctx)
+{
+    TRACE_SCOPE("SceneLoader::finishLoad");
+    installLoad(ctx);
 
-            fmt::printf("Scene reloaded\n");
+    // A change that came in while loading is picked up even if this load failed
+    if(_reloadAgain)
+        startLoad(ctx);
+}
+
+void SceneLoader::installLoad(context* ctx)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<Library> library;
+    try {
+        library = _loading.get();
+    } catch(std::exception& e) {
+        fmt::printf("%s\n%s\n", e.what(), _current.handle ? "Keeping the current scene" : "No scene loaded");
+        return;
+    }
+
+    // The running scene hands its state over when both sides know how
+    std::unique_ptr<StateReader> state;
+    if(_current.sceneObj.save_state && library->sceneObj.restore_state) {
+        StateWriter writer;
+        _current.sceneObj.save_state(ctx, &writer);
+        state.reset(new StateReader(writer.finish()));
+    }
+
+    try {
+        if(state)
+            library->sceneObj.restore_state(ctx, state.get());
+        library->sceneObj.init(ctx);
+    } catch(std::exception& e) {
+        try {
+            closeLibrary(*library, ctx);
+        } catch(std::exception&) {
         }
+
+        fmt::printf("%s\n", e.what());
+
+        // What was handed over is lost, the current scene builds it again
+        if(state) {
+            state->releaseUnclaimed();
+            try {
+                _current.sceneObj.init(ctx);
+            } catch(std::exception& initError) {
+                fmt::printf("%s\n", initError.what());
+                try {
+                    closeLibrary(_current, ctx);
+                } catch(std::exception&) {
+                }
+                _current = Library{};
+            }
+        }
+        fmt::printf("%s\n", _current.handle ? "Keeping the current scene" : "No scene loaded");
+        return;
+    }
+
+    size_t adopted = 0, handedOver = 0;
+    if(state) {
+        adopted = state->adoptedCount();
+        handedOver = state->resourceCount();
+        state->releaseUnclaimed();
     }
+
+    bool reload = _current.handle != nullptr;
+    closeLibrary(_current, ctx);
+    _current = *library;
+    _loadCount++;
+    _loadTime = time(nullptr);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if(reload)
+        fmt::printf("Reloaded %s in %.1f ms, %u of %u resources adopted\n",
+                    _filename, ms, (unsigned)adopted, (unsigned)handedOver);
+    else
+        fmt::printf("Loaded %s\n", _filename);
 }
 
-void SceneLoader::releaseLibrary(context* ctx)
+void SceneLoader::closeLibrary(Library& library, context* ctx)
 {
-    if(_scene.release) {
+    TRACE_SCOPE("SceneLoader::closeLibrary");
+    if(library.sceneObj.release) {
         if(ctx)
-            _scene.release(ctx);
+            library.sceneObj.release(ctx);
     }
 
-    if(_handle) {
-        dlclose(_handle);
+    if(library.handle) {
+        dlclose(library.handle);
     }
 
-    _scene = {};
-    _handle = nullptr;
-    _timestamp = {};
+    library = Library{};
 }
 
-void SceneLoader::openLibrary(context* ctx)
+/*
+ * On the loader thread. dlopen() hands back the already loaded library
+ * for a path it knows, so each load opens its own copy of the file, which
+ * also leaves the build free to overwrite the original.
+ */
+std::shared_ptr<SceneLoader::Library> SceneLoader::openLibrary(const context* ctx, unsigned attempt)
 {
-    struct stat st;
-    int ret = stat(_filename.c_str(), &st);
-    if(ret == -1) {
+    TRACE_SCOPE("SceneLoader::openLibrary");
+    if(!sys::exists(_filename)) {
         throw Exception(fmt::sprintf("File not found: \"%s\"", _filename));
     }
 
-    void* sceneHandle = dlopen(_filename.c_str(), 0);
+    auto library = std::make_shared<Library>();
+    library->path = fmt::format("{}.{}.{}", _filename, getpid(), attempt);
+    sys::writefile(library->path, sys::readfile(_filename), 0755);
+
+    void* sceneHandle = dlopen(library->path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    unlink(library->path.c_str());
     if(!sceneHandle) {
-        throw Exception(fmt::sprintf("Failed to load file: \"%s\"", _filename));
+        throw Exception(fmt::sprintf("Failed to load file: \"%s\": %s", _filename, dlerror()));
     }
 
     GETSCENEPROC getScene = (GETSCENEPROC)dlsym(sceneHandle, "getScene");
@@ -82,11 +230,41 @@ void SceneLoader::openLibrary(context* ctx)
     scene sceneObj = {};
     getScene(&sceneObj);
 
-    sceneObj.init(ctx);
+    if(sceneObj.prepare) {
+        try {
+            sceneObj.prepare(ctx);
+        } catch(...) {
+            dlclose(sceneHandle);
+            throw;
+        }
+    }
+
+    library->handle = sceneHandle;
+    library->sceneObj = sceneObj;
+    return library;
+}
 
-    _handle = sceneHandle;
-    _timestamp = st.st_mtimespec;
-    _scene = sceneObj;
+unsigned SceneLoader::loadCount() const
+{
+    return _loadCount;
 }
 
+time_t SceneLoader::loadTime() const
+{
+    return _loadTime;
+}
 
+bool SceneLoader::loading() const
+{
+    return _loading.valid();
+}
+
+bool SceneLoader::loaded() const
+{
+    return _current.handle != nullptr;
+}
+
+const std::string& SceneLoader::filename() const
+{
+    return _filename;
+}
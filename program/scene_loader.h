@@ -1,5 +1,7 @@
 #pragma once
 
+#include <future>
+#include <memory>
 #include <string>
 #include <time.h>
 
@@ -7,15 +9,40 @@
 
 struct context;
 
+/*
+ * Loads the scene library and reloads it when it changes.
+ *
+ * The library is copied aside and opened on a worker thread, which also
+ * runs the scene's optional prepare(); the render thread only calls init()
+ * and swaps scenes between two frames once that is done. The running
+ * scene stays in place when the new one fails to load. Scenes
+ * implementing save_state/restore_state pass their state and GL
+ * resources on across the swap.
+ *
+ * The first update() starts loading; reload() asks for another load.
+ */
 class SceneLoader {
     private:
+        struct Library {
+            void* handle;
+            std::string path;           /* Shadow copy, removed once opened */
+            scene sceneObj;
+        };
+
         std::string _filename;
-        timespec _timestamp;
-        void* _handle;
-        scene _scene;
+        Library _current;
+        std::future<std::shared_ptr<Library>> _loading;
+        bool _reloadRequested;
+        bool _reloadAgain;              /* Changed again while loading */
+        unsigned _loadCount;
+        unsigned _attempts;
+        time_t _loadTime;
 
-        void releaseLibrary(context* ctx);
-        void openLibrary(context* ctx);
+        void startLoad(context* ctx);
+        void finishLoad(context* ctx);
+        void installLoad(context* ctx);
+        std::shared_ptr<Library> openLibrary(const context* ctx, unsigned attempt);
+        static void closeLibrary(Library& library, context* ctx);
     public:
         SceneLoader(std::string filename);
         ~SceneLoader();
@@ -25,8 +52,21 @@ class SceneLoader {
         SceneLoader& operator=(const SceneLoader&) = delete;
         SceneLoader& operator=(SceneLoader&&) = delete;
 
+        void reload();
         void update(context* ctx);
+        void wait(context* ctx);        /* Blocks until a load in progress is done */
+        void step(float dt, context* ctx);     /* Fixed simulation step, see scene::update */
         void draw(float ticks, context* ctx);
-};
 
+        // For scenes with build/submit, see scene
+        bool pipelined() const;
+        void build(const frame_input* input, int slot);
+        void submit(context* ctx, int slot);
 
+        // Successful loads so far, the first one included, and when the last one happened
+        unsigned loadCount() const;
+        time_t loadTime() const;
+        bool loading() const;
+        bool loaded() const;
+        const std::string& filename() const;
+};
@@ -0,0 +1,23 @@
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : require
+
+// vim: ft=glsl:
+
+/*
+ * lamp.vs for multi-draw indirect: model matrices come from an SSBO
+ * indexed by the draw id instead of a uniform
+ */
+
+layout (location = 0) in vec3 aPos;
+
+layout (std430, binding = 0) readonly buffer DrawData {
+    mat4 models[];
+};
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    gl_Position = projection * view * models[gl_DrawIDARB] * vec4(aPos, 1.0);
+}
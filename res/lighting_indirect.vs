@@ -0,0 +1,34 @@
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : require
+
+// vim: ft=glsl:
+
+/*
+ * lighting.vs for multi-draw indirect: model matrices come from an SSBO
+ * indexed by the draw id instead of a uniform
+ */
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+layout (std430, binding = 0) readonly buffer DrawData {
+    mat4 models[];
+};
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+void main()
+{
+    mat4 model = models[gl_DrawIDARB];
+
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(model))) * aNormal;
+    TexCoords = aTexCoords;
+}
@@ -4,13 +4,14 @@
 out vec4 fragColor;
 
 in vec2 fsTexCoord;
+in vec4 fsColor;
 
 uniform sampler2D texture1;
 
 void main()
 {
     vec4 col = texture(texture1, fsTexCoord);
-    fragColor = vec4(col.r, col.r, col.r, col.r);
+    fragColor = vec4(fsColor.rgb, fsColor.a * col.r);
 }
 
 
@@ -1,15 +1,20 @@
 #version 330 core
 // vim: set ft=glsl:
 
-layout (location = 0) in vec3 position;
+layout (location = 0) in vec2 position;
 layout (location = 1) in vec2 texCoord;
+layout (location = 2) in vec4 color;
 
 out vec2 fsTexCoord;
+out vec4 fsColor;
+
+uniform mat4 projection;
 
 void main()
 {
-	gl_Position = vec4(position, 1.0);
-	fsTexCoord = vec2(texCoord.x, texCoord.y);
+	gl_Position = projection * vec4(position, 0.0, 1.0);
+	fsTexCoord = texCoord;
+	fsColor = color;
 }
 
 
@@ -0,0 +1,18 @@
+#version 330 core
+// vim: set ft=glsl:
+
+out vec4 fragColor;
+
+in vec2 fsTexCoord;
+in vec4 fsColor;
+
+uniform sampler2D texture1;
+
+void main()
+{
+    // Edge at 0.5, smoothed over about one screen pixel whatever the scale
+    float dist = texture(texture1, fsTexCoord).r;
+    float width = max(fwidth(dist), 0.0001);
+    float alpha = smoothstep(0.5 - width, 0.5 + width, dist);
+    fragColor = vec4(fsColor.rgb, fsColor.a * alpha);
+}
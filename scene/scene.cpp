@@ -9,93 +9,263 @@
 #include "scene.h"
 #include "shader.h"
 #include "image.h"
+#include "texture.h"
 #include "meshes.h"
+#include "culling.h"
+#include "occlusion.h"
+#include "render_queue.h"
+#include "indirect_draw.h"
+#include "bvh.h"
+#include "profiler.h"
+#include "scene_state.h"
+
+// Radius of the sphere enclosing a unit cube, whatever its rotation
+static const float CUBE_RADIUS = 0.8660254f;
+
+// Container rotation, degrees per second of simulated time
+static const float SPIN_SPEED = 10.0f;
+
+// Bump when the saved state layout changes
+static const uint32_t STATE_VERSION = 2;
 
 static unsigned int vao;
+static unsigned int vbo;
 static std::shared_ptr<Shader> shader;
+static std::shared_ptr<Shader> indirectShader;     /* Only when multi-draw indirect is supported */
+static std::shared_ptr<IndirectBatch> containerBatch;
 
-static unsigned int diffuseMap;
-static unsigned int specularMap;
+static std::shared_ptr<Texture> diffuseMap;
+static std::shared_ptr<Texture> specularMap;
+static size_t textureMemory;
+static std::shared_ptr<Image> diffuseImage;     /* Decoded by prepare(), until init() */
+static std::shared_ptr<Image> specularImage;
+static uint64_t diffuseImageKey, specularImageKey;  /* Texture::sourceKey() before decoding */
 
 static unsigned int lampVao;
+static unsigned int lampVbo;
 static std::shared_ptr<Shader> lampShader;
 
+static uint64_t frameCount;                     /* Survives reloads */
+static float spin, previousSpin;                /* Degrees, over the last two update() steps */
+
+static std::shared_ptr<OcclusionCuller> occlusionCuller;
+
+struct Material {
+    float shininess;
+};
+
+static const Material containerMaterial = { 64.0f };
+
+static void applyMaterial(unsigned program, const void* data)
+{
+    auto material = static_cast<const Material*>(data);
+    glUniform1f(glGetUniformLocation(program, "material.shininess"), material->shininess);
+}
+
+// Sort key depth, normalized over the camera range
+static float sortDepth(const Camera& camera, const glm::vec3& position)
+{
+    return glm::length(position - camera.position()) / Camera::DEFAULT_FAR;
+}
+
+// Runs on the loader thread, no GL here
+static void prepare(const context* ctx)
+{
+    diffuseImageKey = Texture::sourceKey(fmt::format("{}/container2.png", ctx->resDir));
+    diffuseImage = std::make_shared<Image>(fmt::format("{}/container2.png", ctx->resDir));
+    specularImageKey = Texture::sourceKey(fmt::format("{}/container2_specular.png", ctx->resDir));
+    specularImage = std::make_shared<Image>(fmt::format("{}/container2_specular.png", ctx->resDir));
+}
+
+static uint64_t meshKey(const float* vertices, size_t size, const char* layout)
+{
+    return state_hash(layout, strlen(layout), state_hash(vertices, size));
+}
+
+static std::shared_ptr<Shader> adoptShader(StateReader* state, const char* name,
+                                           const std::string& vertexShaderFile,
+                                           const std::string& fragmentShaderFile)
+{
+    uint64_t key = Shader::sourceKey(vertexShaderFile, fragmentShaderFile);
+    unsigned int program = state->adopt(name, RESOURCE_PROGRAM, key);
+    if(!program)
+        return nullptr;
+    return std::make_shared<Shader>(vertexShaderFile, fragmentShaderFile, program, key);
+}
+
+static std::shared_ptr<Texture> adoptTexture(StateReader* state, const char* name, const std::string& filename)
+{
+    uint64_t key = Texture::sourceKey(filename);
+    unsigned int id = state->adopt(name, RESOURCE_TEXTURE, key);
+    if(!id)
+        return nullptr;
+    return std::make_shared<Texture>(filename, id, key);
+}
+
+// Vertex array and its buffer go together
+static void adoptMesh(StateReader* state, const char* name, uint64_t key, unsigned int& vertexArray, unsigned int& buffer)
+{
+    vertexArray = state->adopt(fmt::format("{}.vao", name), RESOURCE_VERTEX_ARRAY, key);
+    buffer = state->adopt(fmt::format("{}.vbo", name), RESOURCE_BUFFER, key);
+    if(!vertexArray || !buffer) {
+        glDeleteVertexArrays(1, &vertexArray);
+        glDeleteBuffers(1, &buffer);
+        vertexArray = buffer = 0;
+    }
+}
+
+// Keyed by what it was built from. One still reloading is left to
+// release(), the next library builds it from the new file.
+static void handOverShader(StateWriter* state, const char* name, std::shared_ptr<Shader>& shader)
+{
+    if(shader && !shader->reloading()) {
+        uint64_t key = shader->key();
+        state->addResource(name, RESOURCE_PROGRAM, shader->release(), key);
+    }
+    shader.reset();
+}
+
+static void handOverTexture(StateWriter* state, const char* name, std::shared_ptr<Texture>& texture)
+{
+    if(texture && !texture->reloading()) {
+        uint64_t key = texture->key();
+        state->addResource(name, RESOURCE_TEXTURE, texture->release(), key);
+    }
+    texture.reset();
+}
+
+// Called before init() with what the previous library handed over
+static void restore_state(context* ctx, StateReader* state)
+{
+    if(state->version() != STATE_VERSION)
+        return;
+
+    frameCount = state->read<uint64_t>();
+    spin = state->read<float>();
+    previousSpin = state->read<float>();
+
+    adoptMesh(state, "container", meshKey(cube3, sizeof(cube3), "p3n3t2"), vao, vbo);
+    adoptMesh(state, "lamp", meshKey(cube1, sizeof(cube1), "p3"), lampVao, lampVbo);
+
+    diffuseMap = adoptTexture(state, "diffuseMap", fmt::format("{}/container2.png", ctx->resDir));
+    specularMap = adoptTexture(state, "specularMap", fmt::format("{}/container2_specular.png", ctx->resDir));
+
+    shader = adoptShader(state, "shader",
+                         fmt::format("{}/lighting.vs", ctx->resDir),
+                         fmt::format("{}/lighting.fs", ctx->resDir));
+    if(IndirectBatch::supported()) {
+        indirectShader = adoptShader(state, "indirectShader",
+                                     fmt::format("{}/lighting_indirect.vs", ctx->resDir),
+                                     fmt::format("{}/lighting.fs", ctx->resDir));
+    }
+    lampShader = adoptShader(state, "lampShader",
+                             fmt::format("{}/lamp.vs", ctx->resDir),
+                             fmt::format("{}/lamp.fs", ctx->resDir));
+}
+
+// Hands everything reusable over to the next library, release() then skips it
+static void save_state(context* ctx, StateWriter* state)
+{
+    state->setVersion(STATE_VERSION);
+    state->write(frameCount);
+    state->write(spin);
+    state->write(previousSpin);
+
+    uint64_t containerKey = meshKey(cube3, sizeof(cube3), "p3n3t2");
+    state->addResource("container.vao", RESOURCE_VERTEX_ARRAY, vao, containerKey);
+    state->addResource("container.vbo", RESOURCE_BUFFER, vbo, containerKey);
+    uint64_t lampKey = meshKey(cube1, sizeof(cube1), "p3");
+    state->addResource("lamp.vao", RESOURCE_VERTEX_ARRAY, lampVao, lampKey);
+    state->addResource("lamp.vbo", RESOURCE_BUFFER, lampVbo, lampKey);
+    vao = vbo = lampVao = lampVbo = 0;
+
+    handOverTexture(state, "diffuseMap", diffuseMap);
+    handOverTexture(state, "specularMap", specularMap);
+    ctx->textureMemory -= textureMemory;
+    textureMemory = 0;
+
+    handOverShader(state, "shader", shader);
+    handOverShader(state, "indirectShader", indirectShader);
+    handOverShader(state, "lampShader", lampShader);
+}
+
+// Creates whatever restore_state() didn't adopt
 static void init(context* ctx)
 {
-    // Create container
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-
-    unsigned int vbo;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cube3), cube3, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
-                          8 * sizeof(float),
-                          BUFFER_OBJECT(0));
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
-                          8 * sizeof(float),
-                          BUFFER_OBJECT(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE,
-                          8 * sizeof(float),
-                          BUFFER_OBJECT(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    
-    Image diffuseTexture(fmt::format("{}/container2.png", ctx->resDir));
-    glGenTextures(1, &diffuseMap);
-    glBindTexture(GL_TEXTURE_2D, diffuseMap);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_RGB,
-                 diffuseTexture.getWidth(), diffuseTexture.getHeight(),
-                 0,
-                 diffuseTexture.getChannels() == 3 ? GL_RGB : GL_RGBA,
-                 GL_UNSIGNED_BYTE,
-                 diffuseTexture.getData());
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    Image specularTexture(fmt::format("{}/container2_specular.png", ctx->resDir)); 
-    glGenTextures(1, &specularMap);
-    glBindTexture(GL_TEXTURE_2D, specularMap);
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_RGB,
-                 specularTexture.getWidth(), specularTexture.getHeight(),
-                 0,
-                 specularTexture.getChannels() == 3 ? GL_RGB : GL_RGBA,
-                 GL_UNSIGNED_BYTE,
-                 specularTexture.getData());
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    shader = std::make_shared<Shader>(fmt::format("{}/lighting.vs", ctx->resDir),
-                                      fmt::format("{}/lighting.fs", ctx->resDir));
-    
-    // Create Lamp
-    glGenVertexArrays(1, &lampVao);
-    glBindVertexArray(lampVao);
+    if(!vao) {
+        // Create container
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
+
+        glGenBuffers(1, &vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(cube3), cube3, GL_STATIC_DRAW);
+
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
+                              8 * sizeof(float),
+                              BUFFER_OBJECT(0));
+        glEnableVertexAttribArray(0);
+
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
+                              8 * sizeof(float),
+                              BUFFER_OBJECT(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE,
+                              8 * sizeof(float),
+                              BUFFER_OBJECT(6 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+    }
 
-    unsigned int lightVbo;
-    glGenBuffers(1, &lightVbo);
-    glBindBuffer(GL_ARRAY_BUFFER, lightVbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cube1), cube1, GL_STATIC_DRAW);
+    if(!diffuseMap || !specularMap) {
+        if(!diffuseImage)
+            prepare(ctx);
+        if(!diffuseMap)
+            diffuseMap = std::make_shared<Texture>(fmt::format("{}/container2.png", ctx->resDir), *diffuseImage, diffuseImageKey);
+        if(!specularMap)
+            specularMap = std::make_shared<Texture>(fmt::format("{}/container2_specular.png", ctx->resDir), *specularImage, specularImageKey);
+    }
+    diffuseImage.reset();
+    specularImage.reset();
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
-                          3 * sizeof(float), 
-                          BUFFER_OBJECT(0));
-    glEnableVertexAttribArray(0);
+    textureMemory = diffuseMap->memorySize() + specularMap->memorySize();
+    ctx->textureMemory += textureMemory;
 
-    lampShader= std::make_shared<Shader>(fmt::format("{}/lamp.vs", ctx->resDir),
-                                          fmt::format("{}/lamp.fs", ctx->resDir));
+    if(!shader) {
+        shader = std::make_shared<Shader>(fmt::format("{}/lighting.vs", ctx->resDir),
+                                          fmt::format("{}/lighting.fs", ctx->resDir));
+    }
+
+    // All the containers in a single multi-draw when possible
+    if(IndirectBatch::supported()) {
+        if(!indirectShader) {
+            indirectShader = std::make_shared<Shader>(fmt::format("{}/lighting_indirect.vs", ctx->resDir),
+                                                      fmt::format("{}/lighting.fs", ctx->resDir));
+        }
+        containerBatch = std::make_shared<IndirectBatch>();
+    }
+    
+    if(!lampVao) {
+        // Create Lamp
+        glGenVertexArrays(1, &lampVao);
+        glBindVertexArray(lampVao);
+
+        glGenBuffers(1, &lampVbo);
+        glBindBuffer(GL_ARRAY_BUFFER, lampVbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(cube1), cube1, GL_STATIC_DRAW);
+
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
+                              3 * sizeof(float), 
+                              BUFFER_OBJECT(0));
+        glEnableVertexAttribArray(0);
+    }
+
+    if(!lampShader) {
+        lampShader = std::make_shared<Shader>(fmt::format("{}/lamp.vs", ctx->resDir),
+                                              fmt::format("{}/lamp.fs", ctx->resDir));
+    }
+
+    occlusionCuller = std::make_shared<OcclusionCuller>(256, 128);
 
     glEnable(GL_DEPTH_TEST);
     glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
@@ -103,108 +273,280 @@ static void init(context* ctx)
 
 static void release(context* ctx)
 {
+    diffuseMap.reset();
+    specularMap.reset();
+    ctx->textureMemory -= textureMemory;
+    textureMemory = 0;
+
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &lampVao);
+    glDeleteBuffers(1, &lampVbo);
+    vao = vbo = lampVao = lampVbo = 0;
+
+    occlusionCuller.reset();
+    containerBatch.reset();
+    indirectShader.reset();
+    shader.reset();
+    lampShader.reset();
 }
 
-static void draw(float ticks, context* ctx)
+static void setLightingUniforms(Shader& program, const glm::vec3& viewPos,
+                                const glm::vec3* pointLightPositions, int pointLightCount,
+                                const glm::mat4& view, const glm::mat4& projection)
 {
-    static glm::vec3 cubePositions[] = {
-        glm::vec3( 0.0f,  0.0f,  0.0f), 
-        glm::vec3( 2.0f,  5.0f, -15.0f), 
-        glm::vec3(-1.5f, -2.2f, -2.5f),  
-        glm::vec3(-3.8f, -2.0f, -12.3f),  
-        glm::vec3( 2.4f, -0.4f, -3.5f),  
-        glm::vec3(-1.7f,  3.0f, -7.5f),  
-        glm::vec3( 1.3f, -2.0f, -2.5f),  
-        glm::vec3( 1.5f,  2.0f, -2.5f), 
-        glm::vec3( 1.5f,  0.2f, -1.5f), 
-        glm::vec3(-1.3f,  1.0f, -1.5f)  
-    };
-
-    static glm::vec3 pointLightPositions[] = {
-        glm::vec3( 0.7f, 0.2f, 2.0f),
-        glm::vec3( 2.3f, -3.3f, -4.0f),
-        glm::vec3(-4.0f, 2.0f, -12.0f),
-        glm::vec3( 0.0f, 0.0f, -3.0f)
-    };
-
-    // Draw container
-    shader->use();
-    shader->setVec3("viewPos", ctx->camera.position());
+    program.use();
+    program.setVec3("viewPos", viewPos);
 
     // Directional light
-    shader->setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-    shader->setVec3("dirLight.ambient",  0.1f, 0.1f, 0.1f);
-    shader->setVec3("dirLight.diffuse",  0.50f, 0.50f, 0.50f);
-    shader->setVec3("dirLight.specular", 1.0f, 1.0f, 1.0f); 
+    program.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
+    program.setVec3("dirLight.ambient",  0.1f, 0.1f, 0.1f);
+    program.setVec3("dirLight.diffuse",  0.50f, 0.50f, 0.50f);
+    program.setVec3("dirLight.specular", 1.0f, 1.0f, 1.0f); 
     
     // Point Lights
-    shader->setInt("pointLightCount", sizeof(pointLightPositions) / sizeof(pointLightPositions[0]));
-    for(int i = 0; i < sizeof(pointLightPositions) / sizeof(pointLightPositions[0]); i++) {
-        shader->setVec3(fmt::sprintf("pointLights[%d].position", i), pointLightPositions[i]);
-        shader->setFloat(fmt::sprintf("pointLights[%d].constant", i), 1.0f);
-        shader->setFloat(fmt::sprintf("pointLights[%d].linear", i), 0.09f);
-        shader->setFloat(fmt::sprintf("pointLights[%d].quadratic", i), 0.032f);
-
-        shader->setVec3(fmt::sprintf("pointLights[%d].ambient", i),  0.2f, 0.2f, 0.2f);
-        shader->setVec3(fmt::sprintf("pointLights[%d].diffuse", i),  0.75f, 0.75f, 0.75f);
-        shader->setVec3(fmt::sprintf("pointLights[%d].specular", i), 1.0f, 1.0f, 1.0f); 
+    program.setInt("pointLightCount", pointLightCount);
+    for(int i = 0; i < pointLightCount; i++) {
+        program.setVec3(fmt::sprintf("pointLights[%d].position", i), pointLightPositions[i]);
+        program.setFloat(fmt::sprintf("pointLights[%d].constant", i), 1.0f);
+        program.setFloat(fmt::sprintf("pointLights[%d].linear", i), 0.09f);
+        program.setFloat(fmt::sprintf("pointLights[%d].quadratic", i), 0.032f);
+
+        program.setVec3(fmt::sprintf("pointLights[%d].ambient", i),  0.2f, 0.2f, 0.2f);
+        program.setVec3(fmt::sprintf("pointLights[%d].diffuse", i),  0.75f, 0.75f, 0.75f);
+        program.setVec3(fmt::sprintf("pointLights[%d].specular", i), 1.0f, 1.0f, 1.0f); 
     }
 
-    shader->setFloat("material.shininess", 64.0f);
+    program.setInt("material.diffuse", 0);
+    program.setInt("material.specular", 1);
 
-    glBindVertexArray(vao);
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, diffuseMap);
-    shader->setInt("material.diffuse", 0);
+    program.setMatrix("view", view);
+    program.setMatrix("projection", projection);
+}
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, specularMap);
-    shader->setInt("material.specular", 1);
+static glm::vec3 cubePositions[] = {
+    glm::vec3( 0.0f,  0.0f,  0.0f), 
+    glm::vec3( 2.0f,  5.0f, -15.0f), 
+    glm::vec3(-1.5f, -2.2f, -2.5f),  
+    glm::vec3(-3.8f, -2.0f, -12.3f),  
+    glm::vec3( 2.4f, -0.4f, -3.5f),  
+    glm::vec3(-1.7f,  3.0f, -7.5f),  
+    glm::vec3( 1.3f, -2.0f, -2.5f),  
+    glm::vec3( 1.5f,  2.0f, -2.5f), 
+    glm::vec3( 1.5f,  0.2f, -1.5f), 
+    glm::vec3(-1.3f,  1.0f, -1.5f)  
+};
+
+static glm::vec3 pointLightPositions[] = {
+    glm::vec3( 0.7f, 0.2f, 2.0f),
+    glm::vec3( 2.3f, -3.3f, -4.0f),
+    glm::vec3(-4.0f, 2.0f, -12.0f),
+    glm::vec3( 0.0f, 0.0f, -3.0f)
+};
+
+static const size_t cubeCount = sizeof(cubePositions) / sizeof(cubePositions[0]);
+static const int pointLightCount = sizeof(pointLightPositions) / sizeof(pointLightPositions[0]);
+
+// Everything build() leaves for submit()
+struct FrameData {
+    glm::mat4 view, projection;
+    glm::vec3 viewPos;
+    RenderQueue renderQueue;
+    std::vector<glm::mat4> containerModels;    /* For the indirect batch */
+    unsigned culledObjects;
+    unsigned picked;                            /* See frame_stats::picked */
+};
+
+static FrameData frames[SCENE_FRAME_SLOTS];
+
+static void update(float dt, context* ctx)
+{
+    previousSpin = spin;
+    spin += SPIN_SPEED * dt;
+    if(spin >= 360.0f) {
+        spin -= 360.0f;
+        previousSpin -= 360.0f;
+    }
+}
 
-    auto view = glm::lookAt(ctx->camera.position(),
-                            ctx->camera.position() + ctx->camera.front(),
-                            ctx->camera.up());
+// No GL here, see scene::build
+static void build(const frame_input* input, int slot)
+{
+    FrameData& frame = frames[slot];
+
+    float aspect = (float)input->windowWidth / (float)input->windowHeight;
+    frame.view = input->camera.getViewMatrix();
+    frame.projection = input->camera.getProjectionMatrix(aspect);
+    frame.viewPos = input->camera.position();
+    frame.culledObjects = 0;
+    Frustum frustum(frame.projection * frame.view);
+
+    frame.renderQueue.clear();
+    frame.containerModels.clear();
+
+    // Cull containers before submitting them
+    static SphereBatch cubeBounds;
+    static Bvh cubeBvh;
+    static std::vector<uint32_t> visibleCubes;
+    if(cubeBounds.size() != cubeCount) {
+        cubeBounds.clear();
+        std::vector<AABB> boxes;
+        for(size_t i = 0; i < cubeCount; i++) {
+            cubeBounds.push_back(cubePositions[i], CUBE_RADIUS);
+            boxes.push_back(AABB{ cubePositions[i] - glm::vec3(CUBE_RADIUS),
+                                  cubePositions[i] + glm::vec3(CUBE_RADIUS) });
+        }
+        cubeBvh.build(boxes);
+    }
 
-    auto projection = glm::perspective(glm::radians(ctx->camera.zoom()),
-                                       (float)ctx->windowWidth / (float)ctx->windowHeight,
-                                       0.1f, 100.0f);
+    // Container under the crosshair
+    BvhHit hit;
+    Ray ray = input->camera.getRay(0.0f, 0.0f, aspect);
+    frame.picked = cubeBvh.raycast(ray, Camera::DEFAULT_FAR, hit) ? hit.primitive + 1 : 0;
 
-    shader->setMatrix("view", view);
-    shader->setMatrix("projection", projection);
+    visibleCubes.clear();
+    cullSpheres(frustum, cubeBounds, visibleCubes);
+    frame.culledObjects += cubeCount - visibleCubes.size();
 
-    for(int i = 0; i < sizeof(cubePositions) / sizeof(cubePositions[0]); i++) {
+    static glm::mat4 cubeModels[cubeCount];
+    float currentSpin = previousSpin + (spin - previousSpin) * input->alpha;
+    for(uint32_t i : visibleCubes) {
         auto model = glm::mat4(1.0f);
         model = glm::translate(model, cubePositions[i]);
 
-        float angle = 20.0f * i;
+        float angle = 20.0f * i + currentSpin;
         model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-
-        shader->setMatrix("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        cubeModels[i] = model;
     }
 
-    // draw lamp
-    lampShader->use();
-    glBindVertexArray(lampVao);
+    // The containers themselves are the occluders
+    occlusionCuller->beginFrame(frame.projection * frame.view);
+    for(uint32_t i : visibleCubes)
+        occlusionCuller->addOccluder(cube1, 36, 3, cubeModels[i]);
+    occlusionCuller->rasterize();
+
+    for(uint32_t i : visibleCubes) {
+        AABB bounds = { cubePositions[i] - glm::vec3(CUBE_RADIUS),
+                        cubePositions[i] + glm::vec3(CUBE_RADIUS) };
+        if(occlusionCuller->isOccluded(bounds)) {
+            frame.culledObjects++;
+            continue;
+        }
+
+        if(indirectShader) {
+            frame.containerModels.push_back(cubeModels[i]);
+            continue;
+        }
+
+        DrawPacket packet = {};
+        packet.key = RenderQueue::makeKey(0, shader->getId(), vao, 0,
+                                          sortDepth(input->camera, cubePositions[i]));
+        packet.program = shader->getId();
+        packet.vao = vao;
+        packet.textures[0] = diffuseMap->id();
+        packet.textures[1] = specularMap->id();
+        packet.material = &containerMaterial;
+        packet.applyMaterial = applyMaterial;
+        packet.model = cubeModels[i];
+        packet.mode = GL_TRIANGLES;
+        packet.first = 0;
+        packet.count = 36;
+        frame.renderQueue.submit(packet);
+    }
 
-    lampShader->setMatrix("view", view);
-    lampShader->setMatrix("projection", projection);
+    // Lamps
+    for(int i = 0; i < pointLightCount; i++) {
+        float lampRadius = 0.2f * CUBE_RADIUS;
+        AABB lampBounds = { pointLightPositions[i] - glm::vec3(lampRadius),
+                            pointLightPositions[i] + glm::vec3(lampRadius) };
+        if(!frustum.intersectsSphere(pointLightPositions[i], lampRadius) ||
+           occlusionCuller->isOccluded(lampBounds)) {
+            frame.culledObjects++;
+            continue;
+        }
 
-    for(int i = 0; i < sizeof(pointLightPositions) / sizeof(pointLightPositions[0]); i++) {
         auto model = glm::translate(glm::mat4(), pointLightPositions[i]);
         model = glm::scale(model, glm::vec3(0.2f));
 
-        lampShader->setMatrix("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        DrawPacket packet = {};
+        packet.key = RenderQueue::makeKey(0, lampShader->getId(), lampVao, 0,
+                                          sortDepth(input->camera, pointLightPositions[i]));
+        packet.program = lampShader->getId();
+        packet.vao = lampVao;
+        packet.model = model;
+        packet.mode = GL_TRIANGLES;
+        packet.first = 0;
+        packet.count = 36;
+        frame.renderQueue.submit(packet);
+    }
+
+    frame.renderQueue.sort();
+}
+
+static void submit(context* ctx, int slot)
+{
+    PROFILE_GPU("scene");
+    frameCount++;
+    FrameData& frame = frames[slot];
+    ctx->stats.culledObjects += frame.culledObjects;
+    if(frame.picked)
+        ctx->stats.picked = frame.picked;
+
+    setLightingUniforms(*shader, frame.viewPos, pointLightPositions, pointLightCount, frame.view, frame.projection);
+    if(indirectShader)
+        setLightingUniforms(*indirectShader, frame.viewPos, pointLightPositions, pointLightCount, frame.view, frame.projection);
+
+    lampShader->use();
+    lampShader->setMatrix("view", frame.view);
+    lampShader->setMatrix("projection", frame.projection);
+
+    RenderQueue& renderQueue = frame.renderQueue;
+    {
+        PROFILE_GPU("render queue");
+        renderQueue.execute();
     }
+
+    if(indirectShader && !frame.containerModels.empty()) {
+        PROFILE_GPU("indirect containers");
+        containerBatch->clear();
+        for(const auto& model : frame.containerModels)
+            containerBatch->add(36, 0, model);
+
+        indirectShader->use();
+        applyMaterial(indirectShader->getId(), &containerMaterial);
+        glBindVertexArray(vao);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, diffuseMap->id());
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, specularMap->id());
+
+        containerBatch->submit(GL_TRIANGLES);
+        ctx->stats.drawCalls += containerBatch->stats().drawCalls;
+        ctx->stats.bufferStalls += containerBatch->stats().bufferStalls;
+        ctx->stats.uniformUpdates += containerBatch->stats().uniformUpdates;
+    }
+
+    const RenderQueueStats& qs = renderQueue.stats();
+    ctx->stats.drawCalls += qs.drawCalls;
+    ctx->stats.programBinds += qs.programBinds;
+    ctx->stats.programBindsAvoided += qs.programBindsAvoided;
+    ctx->stats.vaoBinds += qs.vaoBinds;
+    ctx->stats.vaoBindsAvoided += qs.vaoBindsAvoided;
+    ctx->stats.textureBinds += qs.textureBinds;
+    ctx->stats.textureBindsAvoided += qs.textureBindsAvoided;
+    ctx->stats.uniformUpdates += qs.uniformUpdates;
 }
 
 extern "C" void getScene(scene* scene_buf)
 {
     scene_buf->init = init;
     scene_buf->release = release;
-    scene_buf->draw = draw;
+    scene_buf->prepare = prepare;
+    scene_buf->save_state = save_state;
+    scene_buf->restore_state = restore_state;
+    scene_buf->update = update;
+    scene_buf->build = build;
+    scene_buf->submit = submit;
 }
 
 